@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+/**
+ * @brief Spin hint for busy-wait loops (PAUSE on x86, yield elsewhere).
+ */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Bounded spin phase whose length adapts to how long waits last.
+ *
+ * Keeps a moving average of how many spins a successful retry took and
+ * spins up to about twice that before giving up, so short gaps are bridged
+ * without a syscall while long ones quickly fall through to blocking. One
+ * instance is shared by all threads waiting on the same condition.
+ */
+class AdaptiveSpin {
+private:
+    static constexpr uint32_t MIN_SPIN = 16;
+    static constexpr uint32_t MAX_SPIN = 4096;
+
+    std::atomic<uint32_t> estimate_{MIN_SPIN};
+
+public:
+    // Retries try_op between spin hints; false if it never succeeded
+    template<typename TryOp>
+    bool spin(TryOp&& try_op) {
+        uint32_t estimate = estimate_.load(std::memory_order_relaxed);
+        uint32_t limit = std::min(MAX_SPIN, 2 * estimate + MIN_SPIN);
+        for (uint32_t i = 0; i < limit; ++i) {
+            cpu_relax();
+            if (try_op()) {
+                estimate_.store((uint32_t)((int32_t)estimate + ((int32_t)i - (int32_t)estimate) / 8), std::memory_order_relaxed);
+                return true;
+            }
+        }
+        // Spinning did not pay off this time; spin less next time
+        estimate_.store(estimate - estimate / 8, std::memory_order_relaxed);
+        return false;
+    }
+};
@@ -0,0 +1,492 @@
+#pragma once
+
+#include "CacheLine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+enum class CellLayout {
+    Compact,   // Cells packed back to back (smallest footprint)
+    Padded,    // One cell per cache line (no sharing, more memory)
+    Remapped   // Packed, but consecutive positions land on different lines
+};
+
+// Number of threads allowed on one side (producers or consumers) of a queue
+enum class Access {
+    Single,    // Exactly one thread: plain loads and stores on that side's cursor
+    Multi      // Any number of threads: cursor claimed with CAS
+};
+
+/**
+ * @brief A fixed-size Lock-Free bounded queue; MPMC by default.
+ * 
+ * Implementation based on Dmitry Vyukov's bounded MPMC queue.
+ * It uses a ring buffer with sequence numbers to coordinate producers and consumers
+ * without locks.
+ *
+ * Cells hold uninitialised storage: an element is constructed in place when a
+ * producer claims a cell and destroyed when a consumer moves it out, so T only
+ * needs to be move-constructible (std::string, std::unique_ptr, large structs).
+ * Element construction must not throw once the cell is claimed, otherwise the
+ * cell is never published and consumers stall at that position. Moving an
+ * element out may throw: the cell is freed anyway and the element (with the
+ * rest of a bulk dequeue) is dropped.
+ *
+ * Layout picks how cells map onto cache lines (see CellLayout). The default
+ * packs them; for small T that puts several neighbouring positions on one
+ * line, so producers and consumers working on adjacent cells false-share.
+ *
+ * Producers/Consumers select how many threads may use each side. A Single
+ * side advances its cursor with a plain store instead of a CAS; the per-cell
+ * sequence numbers still synchronise it with the other side. Use the
+ * MPMCQueue, MPSCQueue, SPMCQueue and SPSCQueue aliases below.
+ */
+template<typename T,
+         Access Producers = Access::Multi,
+         Access Consumers = Access::Multi,
+         CellLayout Layout = CellLayout::Compact>
+class BoundedQueue {
+private:
+    struct CompactCell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    struct alignas(CACHELINE_SIZE) PaddedCell : CompactCell {};
+
+    using Cell = std::conditional_t<Layout == CellLayout::Padded, PaddedCell, CompactCell>;
+    static_assert(std::is_trivially_destructible_v<Cell>, "cells are released without destructors");
+
+    // Cells sharing one line, rounded down to a power of 2 so it divides the capacity
+    static constexpr size_t cells_per_line() {
+        size_t n = 1;
+        while (n * 2 * sizeof(Cell) <= CACHELINE_SIZE) n *= 2;
+        return n;
+    }
+
+    // Releases the cache-line aligned cell array
+    struct CellDeleter {
+        void operator()(Cell* cells) const {
+            ::operator delete[](cells, std::align_val_t(CACHELINE_SIZE));
+        }
+    };
+
+    // Read-mostly fields share the first line; the cursors each get their own
+    std::unique_ptr<Cell[], CellDeleter> buffer_;
+    size_t buffer_mask_;
+    size_t line_shift_;  // log2(number of lines) for CellLayout::Remapped
+
+    // Padding on both sides of each cursor to prevent false sharing between
+    // head, tail, the fields above and whatever follows the queue in memory
+    alignas(CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_;
+    alignas(CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_;
+    char tail_padding_[CACHELINE_SIZE - sizeof(std::atomic<size_t>)];
+
+    Cell& cell_at(size_t pos) {
+        size_t index = pos & buffer_mask_;
+        if constexpr (Layout == CellLayout::Remapped && cells_per_line() > 1) {
+            // Swap the line and slot parts of the index: position i goes to
+            // line (i % lines), slot (i / lines)
+            size_t lines_mask = (size_t(1) << line_shift_) - 1;
+            index = (index & lines_mask) * cells_per_line() + (index >> line_shift_);
+        }
+        return buffer_[index];
+    }
+
+    // Advances a cursor from pos to pos + count. With a single thread on that
+    // side nobody races for the cursor, so a plain store replaces the CAS.
+    template<Access Side>
+    static bool claim(std::atomic<size_t>& cursor, size_t& pos, size_t count) {
+        if constexpr (Side == Access::Single) {
+            cursor.store(pos + count, std::memory_order_relaxed);
+            return true;
+        } else {
+            return cursor.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed);
+        }
+    }
+
+    // Destroys the element in the cell at pos and frees the cell for the
+    // next lap
+    void release(size_t pos) {
+        Cell& cell = cell_at(pos);
+        cell.value()->~T();
+        cell.sequence.store(pos + buffer_mask_ + 1, std::memory_order_release);
+    }
+
+    // Releases the claimed cells [next, end) on scope exit. If a sink or move
+    // throws, the cells are still freed; otherwise every producer that wraps
+    // onto one would spin forever.
+    struct ReleaseGuard {
+        BoundedQueue* queue;
+        size_t next;
+        size_t end;
+
+        ~ReleaseGuard() {
+            for (; next != end; ++next) queue->release(next);
+        }
+    };
+
+    // Claims the next readable cell and hands its element to sink(T&).
+    template<typename Sink>
+    bool consume(Sink&& sink) {
+        Cell* cell;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell = &cell_at(pos);
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (dif == 0) {
+                // The cell is ready for reading (sequence == pos + 1)
+                if (claim<Consumers>(dequeue_pos_, pos, 1)) {
+                    // Success: we claimed this spot. The guard sets sequence to
+                    // pos + mask + 1 to indicate it's free for the NEXT lap
+                    ReleaseGuard guard{this, pos, pos + 1};
+                    sink(*cell->value());
+                    return true;
+                }
+            } else if (dif < 0) {
+                // Queue is empty
+                return false;
+            } else {
+                // Catch up
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    using value_type = T;
+
+    BoundedQueue(size_t buffer_size) 
+        : buffer_(static_cast<Cell*>(::operator new[](
+              buffer_size * sizeof(Cell), std::align_val_t(CACHELINE_SIZE)))),
+          buffer_mask_(buffer_size - 1),
+          line_shift_(0) {
+        // Buffer size must be a power of 2
+        assert((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0));
+
+        for (size_t lines = buffer_size / cells_per_line(); lines > 1; lines >>= 1) {
+            ++line_shift_;
+        }
+
+        for (size_t i = 0; i < buffer_size; ++i) {
+            new (&buffer_[i]) Cell;
+        }
+        for (size_t i = 0; i < buffer_size; ++i) {
+            cell_at(i).sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    ~BoundedQueue() {
+        // Destroy elements that were enqueued but never dequeued
+        size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+        for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos) {
+            Cell& cell = cell_at(pos);
+            if (cell.sequence.load(std::memory_order_relaxed) == pos + 1) {
+                cell.value()->~T();
+            }
+        }
+    }
+
+    // Constructs an element in place from args; returns false if the queue is full.
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+        while (true) {
+            cell = &cell_at(pos);
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+            if (dif == 0) {
+                // The cell is free for writing (sequence == pos)
+                if (claim<Producers>(enqueue_pos_, pos, 1)) {
+                    // Success: we claimed this spot
+                    new (cell->storage) T(std::forward<Args>(args)...);
+                    // Increment sequence to allow reading (pos + 1)
+                    cell->sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                // Queue is full
+                return false;
+            } else {
+                // Sequence > pos: another producer moved enqueue_pos_ forward but hasn't updated the sequence yet?
+                // Or we loaded a stale 'pos'. Reload 'pos'.
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool enqueue(const T& data) {
+        return emplace(data);
+    }
+
+    bool enqueue(T&& data) {
+        return emplace(std::move(data));
+    }
+
+    // Move-assigns the front element into data; returns false if the queue is empty.
+    bool dequeue(T& data) {
+        return consume([&data](T& value) { data = std::move(value); });
+    }
+
+    // Moves the front element out, or returns std::nullopt if the queue is empty.
+    std::optional<T> try_dequeue() {
+        std::optional<T> result;
+        consume([&result](T& value) { result.emplace(std::move(value)); });
+        return result;
+    }
+
+    // Enqueues up to n elements constructed from *first, *(first + 1), ...
+    // Counts the free cells from the current position and claims them all with
+    // a single CAS (or store) on enqueue_pos_; returns how many were enqueued.
+    template<typename InputIt>
+    size_t enqueue_bulk(InputIt first, size_t n) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t count;
+
+        while (true) {
+            count = 0;
+            size_t seq = 0;
+            while (count < n) {
+                seq = cell_at(pos + count).sequence.load(std::memory_order_acquire);
+                if (seq != pos + count) break;
+                ++count;
+            }
+
+            if (count == 0) {
+                if (n == 0 || (intptr_t)seq - (intptr_t)pos < 0) {
+                    // Queue is full
+                    return 0;
+                }
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            } else if (claim<Producers>(enqueue_pos_, pos, count)) {
+                // Cells pos .. pos + count - 1 are ours; nobody else can claim them
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i, ++first) {
+            Cell& cell = cell_at(pos + i);
+            new (cell.storage) T(*first);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // Moves up to max elements to out, out + 1, ... claiming every ready cell
+    // with a single CAS (or store) on dequeue_pos_; returns how many were dequeued.
+    template<typename OutputIt>
+    size_t dequeue_bulk(OutputIt out, size_t max) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t count;
+
+        while (true) {
+            count = 0;
+            size_t seq = 0;
+            while (count < max) {
+                seq = cell_at(pos + count).sequence.load(std::memory_order_acquire);
+                if (seq != pos + count + 1) break;
+                ++count;
+            }
+
+            if (count == 0) {
+                if (max == 0 || (intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+                    // Queue is empty
+                    return 0;
+                }
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            } else if (claim<Consumers>(dequeue_pos_, pos, count)) {
+                break;
+            }
+        }
+
+        ReleaseGuard guard{this, pos, pos + count};
+        for (; guard.next != guard.end; ++out) {
+            *out = std::move(*cell_at(guard.next).value());
+            release(guard.next++);
+        }
+        return count;
+    }
+};
+
+/**
+ * @brief Single-producer single-consumer specialisation (Lamport ring).
+ *
+ * With one thread per side no cell needs a sequence number: the producer
+ * publishes by storing its write index, the consumer frees by storing its
+ * read index. Each side keeps a private copy of the other side's index and
+ * only reloads it (one shared cache-line read) when the copy says the ring
+ * is full or empty. Layout has no effect, as cells carry no atomics.
+ */
+template<typename T, CellLayout Layout>
+class BoundedQueue<T, Access::Single, Access::Single, Layout> {
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    std::unique_ptr<Slot[]> buffer_;
+    size_t buffer_mask_;
+
+    // Producer-owned line: its index plus its cached view of the consumer
+    alignas(CACHELINE_SIZE) std::atomic<size_t> write_idx_{0};
+    size_t read_idx_cache_ = 0;
+    // Consumer-owned line
+    alignas(CACHELINE_SIZE) std::atomic<size_t> read_idx_{0};
+    size_t write_idx_cache_ = 0;
+    char tail_padding_[CACHELINE_SIZE - 2 * sizeof(size_t)];
+
+    // Number of free slots from the producer's point of view, refreshing the
+    // cached read index only if the cached value shows fewer than wanted
+    size_t free_slots(size_t write, size_t wanted) {
+        size_t capacity = buffer_mask_ + 1;
+        if (capacity - (write - read_idx_cache_) < wanted) {
+            read_idx_cache_ = read_idx_.load(std::memory_order_acquire);
+        }
+        return capacity - (write - read_idx_cache_);
+    }
+
+    // Number of readable slots from the consumer's point of view
+    size_t ready_slots(size_t read, size_t wanted) {
+        if (write_idx_cache_ - read < wanted) {
+            write_idx_cache_ = write_idx_.load(std::memory_order_acquire);
+        }
+        return write_idx_cache_ - read;
+    }
+
+    // Destroys the elements of slots [next, end) on scope exit, then frees
+    // them all with one index store. A sink or move that throws drops the
+    // rest of the batch instead of leaving destroyed slots unfreed.
+    struct ReleaseGuard {
+        BoundedQueue* queue;
+        size_t next;
+        size_t end;
+
+        ~ReleaseGuard() {
+            for (; next != end; ++next) queue->buffer_[next & queue->buffer_mask_].value()->~T();
+            queue->read_idx_.store(end, std::memory_order_release);
+        }
+    };
+
+    template<typename Sink>
+    bool consume(Sink&& sink) {
+        size_t read = read_idx_.load(std::memory_order_relaxed);
+        if (ready_slots(read, 1) == 0) {
+            // Queue is empty
+            return false;
+        }
+        ReleaseGuard guard{this, read, read + 1};
+        sink(*buffer_[read & buffer_mask_].value());
+        return true;
+    }
+
+public:
+    using value_type = T;
+
+    BoundedQueue(size_t buffer_size)
+        : buffer_(new Slot[buffer_size]), buffer_mask_(buffer_size - 1) {
+        // Buffer size must be a power of 2
+        assert((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0));
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    ~BoundedQueue() {
+        size_t end = write_idx_.load(std::memory_order_relaxed);
+        for (size_t pos = read_idx_.load(std::memory_order_relaxed); pos != end; ++pos) {
+            buffer_[pos & buffer_mask_].value()->~T();
+        }
+    }
+
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        size_t write = write_idx_.load(std::memory_order_relaxed);
+        if (free_slots(write, 1) == 0) {
+            // Queue is full
+            return false;
+        }
+        new (buffer_[write & buffer_mask_].storage) T(std::forward<Args>(args)...);
+        write_idx_.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool enqueue(const T& data) {
+        return emplace(data);
+    }
+
+    bool enqueue(T&& data) {
+        return emplace(std::move(data));
+    }
+
+    bool dequeue(T& data) {
+        return consume([&data](T& value) { data = std::move(value); });
+    }
+
+    std::optional<T> try_dequeue() {
+        std::optional<T> result;
+        consume([&result](T& value) { result.emplace(std::move(value)); });
+        return result;
+    }
+
+    // Publishes the whole batch with a single index store
+    template<typename InputIt>
+    size_t enqueue_bulk(InputIt first, size_t n) {
+        size_t write = write_idx_.load(std::memory_order_relaxed);
+        size_t count = std::min(n, free_slots(write, n));
+        for (size_t i = 0; i < count; ++i, ++first) {
+            new (buffer_[(write + i) & buffer_mask_].storage) T(*first);
+        }
+        if (count > 0) write_idx_.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // Frees the whole batch with a single index store
+    template<typename OutputIt>
+    size_t dequeue_bulk(OutputIt out, size_t max) {
+        size_t read = read_idx_.load(std::memory_order_relaxed);
+        size_t count = std::min(max, ready_slots(read, max));
+        if (count == 0) return 0;
+        ReleaseGuard guard{this, read, read + count};
+        for (; guard.next != guard.end; ++out) {
+            T* value = buffer_[guard.next & buffer_mask_].value();
+            *out = std::move(*value);
+            value->~T();
+            ++guard.next;
+        }
+        return count;
+    }
+};
+
+template<typename T, CellLayout Layout = CellLayout::Compact>
+using MPMCQueue = BoundedQueue<T, Access::Multi, Access::Multi, Layout>;
+
+template<typename T, CellLayout Layout = CellLayout::Compact>
+using MPSCQueue = BoundedQueue<T, Access::Multi, Access::Single, Layout>;
+
+template<typename T, CellLayout Layout = CellLayout::Compact>
+using SPMCQueue = BoundedQueue<T, Access::Single, Access::Multi, Layout>;
+
+template<typename T, CellLayout Layout = CellLayout::Compact>
+using SPSCQueue = BoundedQueue<T, Access::Single, Access::Single, Layout>;
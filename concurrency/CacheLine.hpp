@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// Assumed size of a destructive-interference unit. Shared atomics that are
+// written by different threads are aligned to it so they never share a line.
+static constexpr size_t CACHELINE_SIZE = 64;
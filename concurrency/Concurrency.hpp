@@ -0,0 +1,25 @@
+#pragma once
+
+// Header-only concurrency building blocks shared by the queue demo, the
+// benchmarks, the thread pool, the scheduler and the logger.
+//
+//   CacheLine.hpp       CACHELINE_SIZE
+//   Backoff.hpp         cpu_relax(), AdaptiveSpin
+//   EventCount.hpp      EventCount: futex-backed sleep for lock-free conditions
+//   BoundedQueue.hpp    BoundedQueue and the MPMC/MPSC/SPMC/SPSC aliases
+//   WaitableQueue.hpp   WaitableQueue: blocking waits and close() on any queue
+//   HazardPointers.hpp  HazardPointers for safe node reclamation
+//   UnboundedQueue.hpp  UnboundedMPMCQueue of linked segments
+//
+// CMakeLists.txt exports the headers as the `concurrency` interface target
+// and builds the unit tests in tests/:
+//
+//   cmake -S concurrency -B build && cmake --build build && ctest --test-dir build
+
+#include "CacheLine.hpp"
+#include "Backoff.hpp"
+#include "EventCount.hpp"
+#include "BoundedQueue.hpp"
+#include "WaitableQueue.hpp"
+#include "HazardPointers.hpp"
+#include "UnboundedQueue.hpp"
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Eventcount: lets threads sleep until a lock-free condition may have
+ * changed, without putting a lock on the fast path.
+ *
+ * Waiter:   key = prepare_wait(); if (condition) cancel_wait(); else wait(key);
+ * Notifier: make condition true; notify();
+ *
+ * The waiter count and epoch share one word. notify() bumps the epoch and
+ * clears the count in a single CAS, waking everyone registered, so while
+ * those waiters are still being scheduled further notifies see no waiters
+ * and return after one fence and one load instead of another syscall.
+ * Parks on a futex (the epoch half of the word) on Linux and on a condition
+ * variable elsewhere.
+ */
+class EventCount {
+private:
+    static constexpr int EPOCH_SHIFT = 32;
+    static constexpr uint64_t WAITER_MASK = (uint64_t(1) << EPOCH_SHIFT) - 1;
+
+    std::atomic<uint64_t> state_{0};  // epoch << 32 | waiters
+#if !defined(__linux__)
+    std::mutex mutex_;
+    std::condition_variable cv_;
+#endif
+
+    static uint32_t epoch_of(uint64_t state) { return (uint32_t)(state >> EPOCH_SHIFT); }
+
+#if defined(__linux__)
+    uint32_t* epoch_word() {
+        static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "futex needs plain words");
+        uint32_t* words = reinterpret_cast<uint32_t*>(&state_);
+        return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? words + 1 : words;
+    }
+#endif
+
+    // Sleeps while the epoch still equals key or until the deadline; false on timeout
+    bool park(uint32_t key, const std::chrono::steady_clock::time_point* deadline) {
+#if defined(__linux__)
+        while (epoch_of(state_.load(std::memory_order_acquire)) == key) {
+            timespec ts;
+            if (deadline) {
+                auto left = *deadline - std::chrono::steady_clock::now();
+                if (left <= std::chrono::steady_clock::duration::zero()) return false;
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+                ts.tv_sec = ns / 1000000000;
+                ts.tv_nsec = ns % 1000000000;
+            }
+            syscall(SYS_futex, epoch_word(), FUTEX_WAIT_PRIVATE, key, deadline ? &ts : nullptr, nullptr, 0);
+        }
+        return true;
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto changed = [&] { return epoch_of(state_.load(std::memory_order_acquire)) != key; };
+        if (!deadline) {
+            cv_.wait(lock, changed);
+            return true;
+        }
+        return cv_.wait_until(lock, *deadline, changed);
+#endif
+    }
+
+    // Drops our registration unless a notify already consumed it; returns
+    // true if a notify happened
+    bool deregister(uint32_t key) {
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        while (epoch_of(state) == key) {
+            if (state_.compare_exchange_weak(state, state - 1, std::memory_order_relaxed)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    // Registers the caller as a waiter; re-check the condition afterwards
+    uint32_t prepare_wait() {
+        uint64_t prev = state_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch_of(prev);
+    }
+
+    // Condition turned out to be true after prepare_wait()
+    void cancel_wait(uint32_t key) {
+        deregister(key);
+    }
+
+    // Blocks until a notify after prepare_wait() returned key
+    void wait(uint32_t key) {
+        park(key, nullptr);
+    }
+
+    // As wait(), but gives up at deadline; returns false on timeout
+    bool wait_until(uint32_t key, std::chrono::steady_clock::time_point deadline) {
+        return park(key, &deadline) || deregister(key);
+    }
+
+    // Wakes every thread registered since the last notify
+    void notify() {
+        // Pairs with the fence in prepare_wait(): either we see the waiter,
+        // or the waiter sees the state change that preceded this call
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        do {
+            if ((state & WAITER_MASK) == 0) return;
+        } while (!state_.compare_exchange_weak(state, (uint64_t)(epoch_of(state) + 1) << EPOCH_SHIFT,
+                                               std::memory_order_release, std::memory_order_relaxed));
+#if defined(__linux__)
+        syscall(SYS_futex, epoch_word(), FUTEX_WAKE_PRIVATE, (int)(state & WAITER_MASK), nullptr, nullptr, 0);
+#else
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+#endif
+    }
+};
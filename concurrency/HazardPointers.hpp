@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief Minimal hazard pointers for safe reclamation of shared nodes.
+ *
+ * Each thread owns a record with SLOTS hazard slots, taken from a global
+ * list on first use and handed back when the thread exits. Before a thread
+ * dereferences a shared node it publishes the pointer in a slot; a node may
+ * only be reused or freed once it is unreachable and no slot holds it.
+ *
+ * Slots may be left set between operations: re-protecting the pointer a slot
+ * already holds then skips the publishing store, at the price of keeping at
+ * most one node per slot per thread from being recycled.
+ */
+class HazardPointers {
+public:
+    static constexpr int SLOTS = 3;
+
+    struct Record {
+        std::atomic<void*> slots[SLOTS] = {};
+        std::atomic<bool> active{false};
+        Record* next = nullptr;
+    };
+
+    // Loads src into slot and returns it once the published value is known
+    // to still be current, i.e. safe to dereference until the slot is cleared.
+    template<typename P>
+    static P* protect(Record* record, int slot, const std::atomic<P*>& src) {
+        std::atomic<void*>& hazard = record->slots[slot];
+        P* ptr = src.load(std::memory_order_acquire);
+        while (true) {
+            // Already published and never cleared since: still protected
+            if (hazard.load(std::memory_order_relaxed) == ptr) return ptr;
+            hazard.store(ptr, std::memory_order_seq_cst);
+            P* again = src.load(std::memory_order_seq_cst);
+            if (again == ptr) return ptr;
+            ptr = again;
+        }
+    }
+
+    static void clear(Record* record, int slot) {
+        record->slots[slot].store(nullptr, std::memory_order_release);
+    }
+
+    // The calling thread's record
+    static Record* local() {
+        thread_local Owner owner;
+        return owner.record;
+    }
+
+    // Snapshot of every pointer currently protected by any thread, sorted
+    static std::vector<void*> collect() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::vector<void*> hazards;
+        for (Record* r = head_.load(std::memory_order_acquire); r; r = r->next) {
+            for (auto& slot : r->slots) {
+                if (void* p = slot.load(std::memory_order_seq_cst)) hazards.push_back(p);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+        return hazards;
+    }
+
+private:
+    static inline std::atomic<Record*> head_{nullptr};
+
+    // Owns the calling thread's record for the lifetime of the thread
+    struct Owner {
+        Record* record;
+
+        Owner() : record(acquire()) {}
+        ~Owner() {
+            for (auto& slot : record->slots) slot.store(nullptr, std::memory_order_relaxed);
+            record->active.store(false, std::memory_order_release);
+        }
+    };
+
+    static Record* acquire() {
+        for (Record* r = head_.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->active.load(std::memory_order_relaxed)
+                && r->active.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return r;
+            }
+        }
+        // Records are never freed; their number is bounded by peak thread count
+        Record* r = new Record;
+        r->active.store(true, std::memory_order_relaxed);
+        r->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {}
+        return r;
+    }
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "Backoff.hpp"
+#include "CacheLine.hpp"
+#include "HazardPointers.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Unbounded lock-free MPMC queue built from linked fixed-size segments.
+ *
+ * Producers and consumers claim cells in the tail/head segment with a single
+ * fetch_add (as in the FAA array queue of Ramalhete and Correia), so the cost
+ * per item is close to the bounded ring. When a segment fills up, a producer
+ * links a new one; when consumers drain one it is retired and, once no hazard
+ * pointer references it, recycled through a lock-free freelist. Memory stays
+ * proportional to the current backlog plus at most MAX_FREE_SEGMENTS spares.
+ *
+ * A consumer that finds a claimed cell still empty waits briefly and then
+ * marks it taken; the slow producer notices and retries in a later cell.
+ * enqueue never fails, so producers never spin on a full queue. If moving an
+ * element out throws, that element is destroyed and the exception propagates.
+ */
+template<typename T, size_t SEGMENT_SIZE = 1024>
+class UnboundedMPMCQueue {
+private:
+    enum : uint8_t { EMPTY = 0, FULL = 1, TAKEN = 2 };
+
+    static constexpr size_t MAX_FREE_SEGMENTS = 8;
+    static constexpr int EMPTY_CELL_SPINS = 64;  // Grace period before giving up on a producer
+
+    // Hazard slots used by this queue
+    static constexpr int HP_TAIL = 0;
+    static constexpr int HP_HEAD = 1;
+    static constexpr int HP_FREELIST = 2;
+
+    struct Cell {
+        std::atomic<uint8_t> state{EMPTY};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    struct Segment {
+        alignas(CACHELINE_SIZE) std::atomic<size_t> enq_idx{0};
+        alignas(CACHELINE_SIZE) std::atomic<size_t> deq_idx{0};
+        alignas(CACHELINE_SIZE) std::atomic<Segment*> next{nullptr};
+        std::atomic<Segment*> next_free{nullptr};  // Link in the freelist or retired list
+        Cell cells[SEGMENT_SIZE];
+
+        void reset() {
+            enq_idx.store(0, std::memory_order_relaxed);
+            deq_idx.store(0, std::memory_order_relaxed);
+            next.store(nullptr, std::memory_order_relaxed);
+            for (auto& cell : cells) cell.state.store(EMPTY, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(CACHELINE_SIZE) std::atomic<Segment*> head_;
+    alignas(CACHELINE_SIZE) std::atomic<Segment*> tail_;
+    alignas(CACHELINE_SIZE) std::atomic<Segment*> free_head_{nullptr};
+    std::atomic<size_t> free_count_{0};
+    size_t max_free_;
+    alignas(CACHELINE_SIZE) std::atomic<Segment*> retired_head_{nullptr};
+
+    static void push(std::atomic<Segment*>& stack, Segment* seg) {
+        Segment* top = stack.load(std::memory_order_relaxed);
+        do {
+            seg->next_free.store(top, std::memory_order_relaxed);
+        } while (!stack.compare_exchange_weak(top, seg, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Segment* allocate_segment(HazardPointers::Record* hp) {
+        // Segments only enter the freelist after a hazard scan, so a segment
+        // we protect here cannot be popped and pushed back underneath us (ABA)
+        Segment* top;
+        while ((top = HazardPointers::protect(hp, HP_FREELIST, free_head_)) != nullptr) {
+            Segment* next = top->next_free.load(std::memory_order_relaxed);
+            if (free_head_.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_relaxed)) {
+                free_count_.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+        HazardPointers::clear(hp, HP_FREELIST);
+        return top ? top : new Segment;
+    }
+
+    // Hands an unreachable segment over for recycling once no thread protects it
+    void retire(Segment* seg) {
+        push(retired_head_, seg);
+
+        Segment* pending = retired_head_.exchange(nullptr, std::memory_order_acquire);
+        std::vector<void*> hazards = HazardPointers::collect();
+        while (pending) {
+            Segment* next = pending->next_free.load(std::memory_order_relaxed);
+            if (std::binary_search(hazards.begin(), hazards.end(), static_cast<void*>(pending))) {
+                push(retired_head_, pending);  // Still in use; try again next time
+            } else if (free_count_.load(std::memory_order_relaxed) < max_free_) {
+                pending->reset();
+                free_count_.fetch_add(1, std::memory_order_relaxed);
+                push(free_head_, pending);
+            } else {
+                delete pending;
+            }
+            pending = next;
+        }
+    }
+
+    // Destroys a taken element on scope exit, so a sink or move that throws
+    // drops the element instead of leaking it
+    struct DestroyGuard {
+        T* value;
+
+        ~DestroyGuard() { value->~T(); }
+    };
+
+    template<typename Sink>
+    bool consume(Sink&& sink) {
+        HazardPointers::Record* hp = HazardPointers::local();
+        while (true) {
+            Segment* head = HazardPointers::protect(hp, HP_HEAD, head_);
+            if (head->deq_idx.load(std::memory_order_acquire) >= head->enq_idx.load(std::memory_order_acquire)
+                && head->next.load(std::memory_order_acquire) == nullptr) {
+                // Queue is empty
+                return false;
+            }
+
+            size_t idx = head->deq_idx.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SEGMENT_SIZE) {
+                Cell& cell = head->cells[idx];
+                // The producer owning this cell may be mid-write; give it a moment
+                for (int i = 0; i < EMPTY_CELL_SPINS && cell.state.load(std::memory_order_acquire) == EMPTY; ++i) {
+                    cpu_relax();
+                }
+                if (cell.state.exchange(TAKEN, std::memory_order_acquire) == FULL) {
+                    DestroyGuard guard{cell.value()};
+                    sink(*guard.value);
+                    return true;
+                }
+                continue;  // Marked an unfilled cell; its producer will retry elsewhere
+            }
+
+            // Segment drained: move head to the next one, if any
+            Segment* next = head->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return false;
+            }
+            // The tail must not lag on the segment we are about to retire
+            Segment* expected = head;
+            tail_.compare_exchange_strong(expected, next, std::memory_order_release, std::memory_order_relaxed);
+            if (head_.compare_exchange_strong(head, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                HazardPointers::clear(hp, HP_HEAD);
+                retire(head);
+            }
+        }
+    }
+
+public:
+    using value_type = T;
+
+    // Optionally pre-allocates spare segments for at least reserve items
+    explicit UnboundedMPMCQueue(size_t reserve = 0)
+        : max_free_(std::max(MAX_FREE_SEGMENTS, reserve / SEGMENT_SIZE)) {
+        Segment* first = new Segment;
+        head_.store(first, std::memory_order_relaxed);
+        tail_.store(first, std::memory_order_relaxed);
+        for (size_t n = SEGMENT_SIZE; n < reserve; n += SEGMENT_SIZE) {
+            push(free_head_, new Segment);
+            free_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    UnboundedMPMCQueue(const UnboundedMPMCQueue&) = delete;
+    UnboundedMPMCQueue& operator=(const UnboundedMPMCQueue&) = delete;
+
+    ~UnboundedMPMCQueue() {
+        for (Segment* seg = head_.load(std::memory_order_relaxed); seg; ) {
+            for (auto& cell : seg->cells) {
+                if (cell.state.load(std::memory_order_relaxed) == FULL) cell.value()->~T();
+            }
+            Segment* next = seg->next.load(std::memory_order_relaxed);
+            delete seg;
+            seg = next;
+        }
+        for (auto* stack : {&free_head_, &retired_head_}) {
+            for (Segment* seg = stack->load(std::memory_order_relaxed); seg; ) {
+                Segment* next = seg->next_free.load(std::memory_order_relaxed);
+                delete seg;
+                seg = next;
+            }
+        }
+    }
+
+    // Constructs an element from args and appends it. Never fails; returns
+    // true for parity with MPMCQueue.
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        // Built once up front: if a consumer gives up on our cell we move it
+        // back out and try the next one
+        std::optional<T> item(std::in_place, std::forward<Args>(args)...);
+        HazardPointers::Record* hp = HazardPointers::local();
+
+        while (true) {
+            Segment* tail = HazardPointers::protect(hp, HP_TAIL, tail_);
+            size_t idx = tail->enq_idx.fetch_add(1, std::memory_order_relaxed);
+
+            if (idx < SEGMENT_SIZE) {
+                Cell& cell = tail->cells[idx];
+                new (cell.storage) T(std::move(*item));
+                uint8_t expected = EMPTY;
+                if (cell.state.compare_exchange_strong(expected, FULL, std::memory_order_release, std::memory_order_relaxed)) {
+                    return true;
+                }
+                item.emplace(std::move(*cell.value()));
+                cell.value()->~T();
+                continue;
+            }
+
+            // Segment full: help advance the tail, or link a new segment
+            if (tail != tail_.load(std::memory_order_acquire)) continue;
+            Segment* next = tail->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                tail_.compare_exchange_strong(tail, next, std::memory_order_release, std::memory_order_relaxed);
+                continue;
+            }
+
+            Segment* seg = allocate_segment(hp);
+            new (seg->cells[0].storage) T(std::move(*item));
+            seg->cells[0].state.store(FULL, std::memory_order_relaxed);
+            seg->enq_idx.store(1, std::memory_order_relaxed);
+
+            Segment* expected = nullptr;
+            if (tail->next.compare_exchange_strong(expected, seg, std::memory_order_release, std::memory_order_relaxed)) {
+                tail_.compare_exchange_strong(tail, seg, std::memory_order_release, std::memory_order_relaxed);
+                return true;
+            }
+            // Another producer linked first; undo and recycle our segment
+            item.emplace(std::move(*seg->cells[0].value()));
+            seg->cells[0].value()->~T();
+            retire(seg);
+        }
+    }
+
+    bool enqueue(const T& data) {
+        return emplace(data);
+    }
+
+    bool enqueue(T&& data) {
+        return emplace(std::move(data));
+    }
+
+    // Move-assigns the front element into data; returns false if the queue is empty.
+    bool dequeue(T& data) {
+        return consume([&data](T& value) { data = std::move(value); });
+    }
+
+    // Moves the front element out, or returns std::nullopt if the queue is empty.
+    std::optional<T> try_dequeue() {
+        std::optional<T> result;
+        consume([&result](T& value) { result.emplace(std::move(value)); });
+        return result;
+    }
+};
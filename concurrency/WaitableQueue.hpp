@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Backoff.hpp"
+#include "EventCount.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Adds blocking wait_enqueue/wait_dequeue to a non-blocking queue.
+ *
+ * Every operation first takes the wrapped queue's lock-free path. Only when
+ * that fails does a caller spin for a bounded, adaptive number of attempts and
+ * then park on an eventcount. Successful operations signal the opposite side,
+ * which is a fence plus a load while nobody is parked. Queues that never
+ * block keep using the plain queue and pay nothing.
+ *
+ * close() is the shutdown signal: blocked callers wake up, and from then on a
+ * wait that cannot complete returns false instead of parking. Pushes are
+ * rejected once the queue is closed. Consumers still drain whatever is queued,
+ * including pushes that were admitted before close(), before they see false.
+ */
+template<typename Queue>
+class WaitableQueue {
+private:
+    Queue queue_;
+    EventCount not_empty_;
+    EventCount not_full_;
+    AdaptiveSpin spin_;
+    // Bit 0: closed. The rest counts pushes admitted but not yet finished, so
+    // a consumer does not report the queue drained while one is landing.
+    std::atomic<uint64_t> state_{0};
+
+    static constexpr uint64_t CLOSED = 1;
+    static constexpr uint64_t PUSH = 2;
+
+    // Registers a push; false if the queue is already closed
+    bool admit() {
+        if (!(state_.fetch_add(PUSH, std::memory_order_seq_cst) & CLOSED)) return true;
+        leave();
+        return false;
+    }
+
+    // Ends a push started by admit(). Wakes consumers that may be waiting
+    // for it before they report the queue drained.
+    void leave() {
+        if (state_.fetch_sub(PUSH, std::memory_order_seq_cst) & CLOSED) not_empty_.notify();
+    }
+
+    // A consumer is done once the queue is closed and no push is in flight;
+    // a producer once the queue is closed
+    bool finished(bool consuming) const {
+        uint64_t state = state_.load(std::memory_order_seq_cst);
+        return consuming ? state == CLOSED : (state & CLOSED) != 0;
+    }
+
+    // Runs try_op until it succeeds, parking on event in between. With a
+    // deadline, gives up once it has passed; gives up as well once the
+    // queue is finished for this side.
+    template<typename TryOp>
+    bool wait_for_op(EventCount& event, bool consuming, TryOp&& try_op,
+                     const std::chrono::steady_clock::time_point* deadline) {
+        if (try_op() || spin_.spin(try_op)) return true;
+        while (true) {
+            uint32_t key = event.prepare_wait();
+            if (try_op()) {
+                event.cancel_wait(key);
+                return true;
+            }
+            // Checked after registering, so a concurrent close() or leave()
+            // either is seen here or sees this waiter and wakes it. A push
+            // that finished since the try above is only visible to a retry.
+            if (finished(consuming)) {
+                event.cancel_wait(key);
+                return consuming && try_op();
+            }
+            if (!deadline) {
+                event.wait(key);
+            } else if (!event.wait_until(key, *deadline)) {
+                return try_op();
+            }
+            if (try_op()) return true;
+        }
+    }
+
+public:
+    using value_type = typename Queue::value_type;
+
+    template<typename... Args>
+    explicit WaitableQueue(Args&&... args) : queue_(std::forward<Args>(args)...) {}
+
+    // False if the queue is full or closed
+    template<typename... Args>
+    bool emplace(Args&&... args) {
+        if (!admit()) return false;
+        bool pushed = queue_.emplace(std::forward<Args>(args)...);
+        if (pushed) not_empty_.notify();
+        leave();
+        return pushed;
+    }
+
+    bool enqueue(const value_type& data) { return emplace(data); }
+    bool enqueue(value_type&& data) { return emplace(std::move(data)); }
+
+    bool dequeue(value_type& data) {
+        if (!queue_.dequeue(data)) return false;
+        not_full_.notify();
+        return true;
+    }
+
+    std::optional<value_type> try_dequeue() {
+        std::optional<value_type> result = queue_.try_dequeue();
+        if (result) not_full_.notify();
+        return result;
+    }
+
+    template<typename InputIt>
+    size_t enqueue_bulk(InputIt first, size_t n) {
+        if (!admit()) return 0;
+        size_t count = queue_.enqueue_bulk(first, n);
+        if (count > 0) not_empty_.notify();
+        leave();
+        return count;
+    }
+
+    template<typename OutputIt>
+    size_t dequeue_bulk(OutputIt out, size_t max) {
+        size_t count = queue_.dequeue_bulk(out, max);
+        if (count > 0) not_full_.notify();
+        return count;
+    }
+
+    // Blocks until there is room, then enqueues; false if closed first
+    bool wait_enqueue(value_type data) {
+        if (!admit()) return false;
+        bool pushed = wait_for_op(not_full_, false, [&] { return queue_.emplace(std::move(data)); }, nullptr);
+        if (pushed) not_empty_.notify();
+        leave();
+        return pushed;
+    }
+
+    // Blocks until an element is available and moves it into data; false
+    // once the queue is closed and empty
+    bool wait_dequeue(value_type& data) {
+        if (!wait_for_op(not_empty_, true, [&] { return queue_.dequeue(data); }, nullptr)) return false;
+        not_full_.notify();
+        return true;
+    }
+
+    // As wait_dequeue(), but gives up after timeout; returns false if nothing arrived
+    template<typename Rep, typename Period>
+    bool wait_dequeue_for(value_type& data, std::chrono::duration<Rep, Period> timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        if (!wait_for_op(not_empty_, true, [&] { return queue_.dequeue(data); }, &deadline)) return false;
+        not_full_.notify();
+        return true;
+    }
+
+    // Wakes every parked thread, e.g. so consumers can observe a shutdown flag
+    void notify_all() {
+        not_empty_.notify();
+        not_full_.notify();
+    }
+
+    // Wakes every blocked caller, rejects pushes and makes waits that cannot
+    // complete return false from now on. Non-blocking pops keep working.
+    void close() {
+        state_.fetch_or(CLOSED, std::memory_order_seq_cst);
+        notify_all();
+    }
+
+    bool closed() const { return state_.load(std::memory_order_acquire) & CLOSED; }
+};
@@ -0,0 +1,349 @@
+#include "BoundedQueue.hpp"
+#include "UnboundedQueue.hpp"
+#include "WaitableQueue.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Unit tests for the queues in this directory: FIFO order, capacity, bulk
+// calls, element lifetimes, exception safety, concurrent delivery and the
+// blocking/close behaviour of WaitableQueue. Each check reports its line;
+// the exit code is non-zero if any failed.
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond \
+                      << std::endl;                                              \
+            ++failures;                                                          \
+        }                                                                        \
+    } while (0)
+
+// Counts live instances. Move-assigning from an instance with bomb set
+// throws, which is how the queues move an element out in dequeue().
+struct Counted {
+    static std::atomic<int> live;
+    int value = 0;
+    bool bomb = false;
+
+    Counted(int v = 0, bool b = false) : value(v), bomb(b) { ++live; }
+    Counted(Counted&& other) noexcept : value(other.value), bomb(other.bomb) { ++live; }
+    Counted& operator=(Counted&& other) {
+        if (other.bomb) throw std::runtime_error("move out");
+        value = other.value;
+        bomb = other.bomb;
+        return *this;
+    }
+    ~Counted() { --live; }
+};
+
+std::atomic<int> Counted::live{0};
+
+using std::chrono::milliseconds;
+
+// --- Single-threaded behaviour ---
+
+// Fills a bounded queue, checks it reports full, then drains it in order
+template<typename Queue>
+void test_bounded_fifo(size_t capacity) {
+    Queue queue(capacity);
+    int value = -1;
+    CHECK(!queue.dequeue(value));
+    CHECK(!queue.try_dequeue());
+
+    size_t accepted = 0;
+    while (accepted < 2 * capacity && queue.enqueue(static_cast<int>(accepted))) ++accepted;
+    CHECK(accepted == capacity);
+
+    for (size_t i = 0; i < accepted; ++i) {
+        CHECK(queue.dequeue(value));
+        CHECK(value == static_cast<int>(i));
+    }
+    CHECK(!queue.dequeue(value));
+
+    // Wraps around the ring several times
+    for (int i = 0; i < 10 * static_cast<int>(capacity); ++i) {
+        CHECK(queue.enqueue(i));
+        auto item = queue.try_dequeue();
+        CHECK(item && *item == i);
+    }
+}
+
+template<typename Queue>
+void test_bounded_bulk() {
+    Queue queue(8);
+    std::vector<int> in = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    CHECK(queue.enqueue_bulk(in.begin(), in.size()) == 8);  // Only what fits
+    CHECK(queue.enqueue_bulk(in.begin(), 1) == 0);
+
+    std::vector<int> out;
+    CHECK(queue.dequeue_bulk(std::back_inserter(out), 5) == 5);
+    CHECK(queue.dequeue_bulk(std::back_inserter(out), 5) == 3);
+    CHECK(queue.dequeue_bulk(std::back_inserter(out), 5) == 0);
+    CHECK(out == std::vector<int>(in.begin(), in.begin() + 8));
+}
+
+void test_unbounded_fifo() {
+    // Small segments, so the run links, drains and recycles many of them
+    UnboundedMPMCQueue<int, 8> queue;
+    int value = -1;
+    CHECK(!queue.dequeue(value));
+    for (int i = 0; i < 1000; ++i) CHECK(queue.enqueue(i));
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(queue.dequeue(value));
+        CHECK(value == i);
+    }
+    CHECK(!queue.try_dequeue());
+}
+
+// Move-only elements go in and out without copies
+template<typename Queue>
+void test_move_only(Queue& queue) {
+    CHECK(queue.emplace(std::make_unique<std::string>("payload")));
+    auto item = queue.try_dequeue();
+    CHECK(item && *item && **item == "payload");
+}
+
+// Elements still queued are destroyed with the queue
+template<typename Queue, typename... Args>
+void test_lifetimes(Args... args) {
+    {
+        Queue queue(args...);
+        for (int i = 0; i < 6; ++i) queue.emplace(i);
+        Counted out;
+        CHECK(queue.dequeue(out) && out.value == 0);
+    }
+    CHECK(Counted::live == 0);
+}
+
+// A throwing move drops that element, but the queue stays usable and
+// nothing leaks
+template<typename Queue, typename... Args>
+void test_throwing_move(Args... args) {
+    {
+        Queue queue(args...);
+        queue.emplace(1);
+        queue.emplace(2, true);
+        queue.emplace(3);
+        Counted out;
+        int received = 0;
+        int thrown = 0;
+        for (int i = 0; i < 3; ++i) {
+            try {
+                if (queue.dequeue(out)) ++received;
+            } catch (const std::runtime_error&) {
+                ++thrown;
+            }
+        }
+        CHECK(received == 2 && thrown == 1 && out.value == 3);
+        CHECK(!queue.dequeue(out));
+
+        for (int i = 0; i < 20; ++i) {
+            CHECK(queue.emplace(i));
+            CHECK(queue.dequeue(out) && out.value == i);
+        }
+    }
+    CHECK(Counted::live == 0);
+}
+
+// --- Concurrent delivery ---
+
+// Every item arrives exactly once, and each consumer sees each producer's
+// items in the order they were pushed
+template<typename Queue, typename... Args>
+void test_concurrent(int producers, int consumers, Args... args) {
+    const uint32_t per_producer = 20000;
+    const uint32_t total = per_producer * producers;
+    Queue queue(args...);
+    std::vector<std::atomic<uint8_t>> seen(total);
+    std::atomic<uint32_t> consumed{0};
+    std::atomic<bool> in_order{true};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint32_t i = 0; i < per_producer; ++i) {
+                while (!queue.enqueue(p * per_producer + i)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int64_t> last(producers, -1);
+            uint32_t item;
+            while (consumed.load() < total) {
+                if (!queue.dequeue(item)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint32_t p = item / per_producer;
+                if (static_cast<int64_t>(item) <= last[p]) in_order = false;
+                last[p] = item;
+                seen[item].fetch_add(1);
+                consumed.fetch_add(1);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    bool once = true;
+    for (auto& s : seen) once = once && s.load() == 1;
+    CHECK(once);
+    CHECK(in_order);
+}
+
+// --- WaitableQueue ---
+
+void test_waitable_blocking() {
+    WaitableQueue<MPMCQueue<int>> queue(2);
+
+    // wait_dequeue parks until a producer arrives
+    std::thread producer([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        queue.enqueue(42);
+    });
+    int value = 0;
+    CHECK(queue.wait_dequeue(value) && value == 42);
+    producer.join();
+
+    // wait_enqueue parks while full until a consumer frees a slot
+    CHECK(queue.enqueue(1) && queue.enqueue(2) && !queue.enqueue(3));
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(milliseconds(20));
+        int v;
+        queue.dequeue(v);
+    });
+    CHECK(queue.wait_enqueue(3));
+    consumer.join();
+
+    // wait_dequeue_for gives up once the timeout passes
+    WaitableQueue<UnboundedMPMCQueue<int>> empty;
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!empty.wait_dequeue_for(value, milliseconds(20)));
+    CHECK(std::chrono::steady_clock::now() - start >= milliseconds(20));
+}
+
+void test_waitable_close() {
+    WaitableQueue<UnboundedMPMCQueue<int>> queue;
+    std::atomic<bool> released{false};
+    std::thread consumer([&] {
+        int v;
+        released = !queue.wait_dequeue(v);
+    });
+    std::this_thread::sleep_for(milliseconds(20));
+    queue.close();
+    consumer.join();
+    CHECK(released);
+    CHECK(queue.closed());
+    CHECK(!queue.enqueue(1));  // Pushes are rejected once closed
+
+    // Items queued before close() are still drained, then waits fail
+    WaitableQueue<MPMCQueue<int>> draining(4);
+    draining.enqueue(1);
+    draining.enqueue(2);
+    draining.close();
+    int v = 0;
+    CHECK(draining.wait_dequeue(v) && v == 1);
+    CHECK(draining.wait_dequeue(v) && v == 2);
+    CHECK(!draining.wait_dequeue(v));
+    CHECK(!draining.wait_enqueue(3));
+}
+
+// close() racing with producers: every accepted push is consumed
+template<typename Queue, typename... Args>
+void test_waitable_close_race(Args... args) {
+    for (int round = 0; round < 20; ++round) {
+        Queue queue(args...);
+        std::atomic<long> accepted{0};
+        std::atomic<long> consumed{0};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 3; ++p) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 20000; ++i) {
+                    if (queue.enqueue(i)) ++accepted;
+                }
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            threads.emplace_back([&] {
+                int v;
+                while (queue.wait_dequeue(v)) ++consumed;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200 * round));
+        queue.close();
+        for (auto& t : threads) t.join();
+        CHECK(accepted == consumed);
+    }
+}
+
+int main() {
+    struct Test {
+        const char* name;
+        void (*run)();
+    };
+    const Test tests[] = {
+        {"bounded fifo", [] {
+             test_bounded_fifo<MPMCQueue<int>>(8);
+             test_bounded_fifo<MPMCQueue<int, CellLayout::Padded>>(8);
+             test_bounded_fifo<MPMCQueue<int, CellLayout::Remapped>>(64);
+             test_bounded_fifo<MPSCQueue<int>>(8);
+             test_bounded_fifo<SPMCQueue<int>>(8);
+             test_bounded_fifo<SPSCQueue<int>>(8);
+         }},
+        {"bounded bulk", [] {
+             test_bounded_bulk<MPMCQueue<int>>();
+             test_bounded_bulk<SPSCQueue<int>>();
+         }},
+        {"unbounded fifo", test_unbounded_fifo},
+        {"move-only elements", [] {
+             MPMCQueue<std::unique_ptr<std::string>> mpmc(4);
+             SPSCQueue<std::unique_ptr<std::string>> spsc(4);
+             UnboundedMPMCQueue<std::unique_ptr<std::string>> unbounded;
+             test_move_only(mpmc);
+             test_move_only(spsc);
+             test_move_only(unbounded);
+         }},
+        {"element lifetimes", [] {
+             test_lifetimes<MPMCQueue<Counted>>(8);
+             test_lifetimes<SPSCQueue<Counted>>(8);
+             test_lifetimes<UnboundedMPMCQueue<Counted, 4>>();
+         }},
+        {"throwing move", [] {
+             test_throwing_move<MPMCQueue<Counted>>(4);
+             test_throwing_move<SPSCQueue<Counted>>(4);
+             test_throwing_move<UnboundedMPMCQueue<Counted>>();
+         }},
+        {"concurrent delivery", [] {
+             test_concurrent<MPMCQueue<uint32_t>>(4, 4, 64);
+             test_concurrent<MPSCQueue<uint32_t>>(4, 1, 64);
+             test_concurrent<SPMCQueue<uint32_t>>(1, 4, 64);
+             test_concurrent<SPSCQueue<uint32_t>>(1, 1, 64);
+             test_concurrent<UnboundedMPMCQueue<uint32_t, 32>>(4, 4);
+             test_concurrent<WaitableQueue<MPMCQueue<uint32_t>>>(2, 2, 16);
+         }},
+        {"waitable blocking", test_waitable_blocking},
+        {"waitable close", test_waitable_close},
+        {"waitable close race", [] {
+             test_waitable_close_race<WaitableQueue<UnboundedMPMCQueue<int>>>();
+             test_waitable_close_race<WaitableQueue<MPMCQueue<int>>>(256);
+         }},
+    };
+
+    for (const Test& test : tests) {
+        int before = failures;
+        test.run();
+        std::cout << (failures == before ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+    }
+    std::cout << (failures == 0 ? "All tests passed" : "Some tests failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,387 @@
+#include "config_manager.hpp"
+#include "concurrency/CacheLine.hpp"
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <shared_mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+
+// Read-path benchmark for ConfigurationManager.
+//
+// Reader threads call getValue in a tight loop while one writer thread
+// publishes reloads through MockSource::updateData at a fixed rate. For each
+// reader count it reports:
+//   - reads per second over all readers;
+//   - read latency percentiles, from every N-th read, less clock overhead;
+//   - reload-to-visibility latency: from the start of updateData until a
+//     reader first reads the new value, once per reader and reload it sees.
+//
+// --impl shared_mutex runs the same workload against the read path the
+// manager had before snapshots (one shared_mutex around an unordered_map,
+// reloads building a new map and swapping it in under the exclusive lock),
+// as the baseline improvements are measured against.
+
+// ==========================================
+// 1. Timing
+// ==========================================
+
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Median cost of the now_ns() pair around a timed read
+inline uint64_t clock_overhead_ns() {
+    static const uint64_t overhead = [] {
+        std::vector<uint64_t> samples(10001);
+        for (auto& s : samples) {
+            uint64_t t0 = now_ns();
+            s = now_ns() - t0;
+        }
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        return samples[samples.size() / 2];
+    }();
+    return overhead;
+}
+
+// Value at fraction p of samples, which it sorts; 0 if there are none
+inline uint64_t percentile(std::vector<uint64_t>& samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t rank = (size_t)(p * (double)(samples.size() - 1) + 0.5);
+    return samples[rank];
+}
+
+// ==========================================
+// 2. Implementations Under Test
+// ==========================================
+
+const std::string SEQ_KEY = "bench.seq";  // Int the writer bumps on every reload
+
+// Fixed keys that give the tables a realistic size
+class FillerSource : public IConfigSource {
+    size_t keys_;
+
+public:
+    explicit FillerSource(size_t keys) : keys_(keys) {}
+
+    std::unordered_map<std::string, ConfigValue> load() override {
+        std::unordered_map<std::string, ConfigValue> data;
+        for (size_t i = 0; i < keys_; ++i) data["bench.filler." + std::to_string(i)] = (int)i;
+        return data;
+    }
+
+    void watch(std::function<void()>) override {}
+
+    std::string name() const override { return "filler"; }
+};
+
+// The real manager; reloads go through MockSource as in the demo
+class ManagerImpl {
+    ConfigurationManager& config_ = ConfigurationManager::getInstance();
+    std::shared_ptr<MockSource> source_ = std::make_shared<MockSource>();
+
+public:
+    explicit ManagerImpl(size_t keys) {
+        config_.addSource(std::make_shared<FillerSource>(keys), Precedence::Defaults);
+        config_.addSource(source_);
+        source_->updateData(SEQ_KEY, 0);
+    }
+
+    int read() const { return config_.getValue<int>(SEQ_KEY, -1); }
+    void publish(int seq) { source_->updateData(SEQ_KEY, seq); }
+};
+
+// The former read path: every read takes a shared lock
+class SharedMutexImpl {
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, ConfigValue> data_;
+
+public:
+    explicit SharedMutexImpl(size_t keys) {
+        data_ = FillerSource(keys).load();
+        data_[SEQ_KEY] = 0;
+    }
+
+    int read() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = data_.find(SEQ_KEY);
+        if (it == data_.end()) return -1;
+        const int* v = std::get_if<int>(&it->second);
+        return v ? *v : -1;
+    }
+
+    void publish(int seq) {
+        std::unordered_map<std::string, ConfigValue> next;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            next = data_;
+        }
+        next[SEQ_KEY] = seq;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        data_.swap(next);
+    }
+};
+
+// ==========================================
+// 3. Runs
+// ==========================================
+
+struct Options {
+    std::vector<std::string> impls{"manager", "shared_mutex"};
+    std::vector<int> threads{1, 2, 4, 8, 16, 32, 64};
+    unsigned rate = 100;  // Reloads per second; 0 disables the writer
+    unsigned duration_ms = 1000;
+    size_t keys = 1000;
+    size_t sample_every = 16;
+    std::string format = "table";
+};
+
+// Results of one reader; aligned so neighbouring readers never share a line
+struct alignas(CACHELINE_SIZE) ReaderStats {
+    uint64_t reads = 0;
+    std::vector<uint64_t> read_ns;
+    std::vector<uint64_t> visible_ns;
+};
+
+struct RunResult {
+    double reads_per_sec = 0;
+    std::vector<uint64_t> read_ns;
+    std::vector<uint64_t> visible_ns;
+    int reloads = 0;
+};
+
+// Reload seq is published with the value first + seq; stamps[seq] holds the
+// time its publish started
+template<typename Impl>
+RunResult run(Impl& impl, const Options& opt, int readers, int first) {
+    size_t max_reloads = (size_t)opt.rate * opt.duration_ms / 1000 + 1;
+    std::vector<std::atomic<uint64_t>> stamps(max_reloads);
+    std::vector<ReaderStats> stats(readers);
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    uint64_t overhead = clock_overhead_ns();
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            ReaderStats& s = stats[r];
+            int last = impl.read();
+            size_t countdown = opt.sample_every;
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            while (!stop.load(std::memory_order_relaxed)) {
+                bool timed = opt.sample_every != 0 && --countdown == 0;
+                uint64_t t0 = timed ? now_ns() : 0;
+                int v = impl.read();
+                if (timed) {
+                    uint64_t t1 = now_ns();
+                    s.read_ns.push_back(t1 - t0 > overhead ? t1 - t0 - overhead : 0);
+                    countdown = opt.sample_every;
+                }
+                ++s.reads;
+                if (v != last) {
+                    last = v;
+                    if (v >= first && (size_t)(v - first) < max_reloads) {
+                        s.visible_ns.push_back(now_ns() - stamps[v - first].load(std::memory_order_acquire));
+                    }
+                }
+            }
+        });
+    }
+    while (ready.load() < readers) std::this_thread::yield();
+
+    // The writer has its own thread so that a starved writer (a reader-
+    // preferring shared_mutex under many readers) still ends the run on time
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)opt.duration_ms * 1000000;
+    std::atomic<int> reloads{0};
+    std::thread writer([&] {
+        if (opt.rate == 0) return;
+        uint64_t interval = 1000000000ull / opt.rate;
+        for (size_t seq = 0; seq < max_reloads && !stop.load(); ++seq) {
+            uint64_t due = start + seq * interval;
+            if (due >= end) break;
+            uint64_t now = now_ns();
+            if (due > now) std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+            stamps[seq].store(now_ns(), std::memory_order_release);
+            impl.publish(first + (int)seq);
+            reloads.fetch_add(1);
+        }
+    });
+    go.store(true, std::memory_order_release);
+    for (uint64_t now = now_ns(); now < end; now = now_ns()) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(end - now));
+    }
+    stop.store(true);
+    uint64_t elapsed = now_ns() - start;
+    for (auto& t : threads) t.join();
+    writer.join();
+
+    RunResult result;
+    result.reloads = reloads.load();
+    uint64_t reads = 0;
+    for (auto& s : stats) {
+        reads += s.reads;
+        result.read_ns.insert(result.read_ns.end(), s.read_ns.begin(), s.read_ns.end());
+        result.visible_ns.insert(result.visible_ns.end(), s.visible_ns.begin(), s.visible_ns.end());
+    }
+    result.reads_per_sec = (double)reads / ((double)elapsed / 1e9);
+    return result;
+}
+
+// ==========================================
+// 4. Reporting
+// ==========================================
+
+void report_header(const Options& opt, std::ostream& out) {
+    if (opt.format == "csv") {
+        out << "impl,readers,reads_per_sec,read_p50_ns,read_p99_ns,reloads,visible_p50_us,visible_p99_us\n";
+        return;
+    }
+    out << "Reloads: " << opt.rate << "/s, duration: " << opt.duration_ms << " ms, keys: " << opt.keys
+        << ", read sampling: 1/" << opt.sample_every << ", clock overhead: " << clock_overhead_ns() << " ns\n\n"
+        << std::left << std::setw(14) << "impl" << std::right << std::setw(8) << "readers" << std::setw(14)
+        << "Mreads/s" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(10) << "reloads"
+        << std::setw(14) << "vis p50 us" << std::setw(14) << "vis p99 us" << "\n";
+}
+
+void report_row(const Options& opt, std::ostream& out, const std::string& impl, int readers, RunResult& r) {
+    uint64_t read50 = percentile(r.read_ns, 0.50), read99 = percentile(r.read_ns, 0.99);
+    double vis50 = percentile(r.visible_ns, 0.50) / 1000.0, vis99 = percentile(r.visible_ns, 0.99) / 1000.0;
+    if (opt.format == "csv") {
+        out << impl << "," << readers << "," << (uint64_t)r.reads_per_sec << "," << read50 << "," << read99 << ","
+            << r.reloads << "," << vis50 << "," << vis99 << std::endl;
+        return;
+    }
+    out << std::left << std::setw(14) << impl << std::right << std::setw(8) << readers << std::fixed
+        << std::setprecision(2) << std::setw(14) << r.reads_per_sec / 1e6 << std::setw(12) << read50
+        << std::setw(12) << read99 << std::setw(10) << r.reloads << std::setprecision(1) << std::setw(14) << vis50
+        << std::setw(14) << vis99 << std::endl;
+}
+
+// ==========================================
+// 5. Command Line
+// ==========================================
+
+void print_usage(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --impl LIST       manager and/or shared_mutex (default: both)\n"
+              << "  --threads LIST    reader thread counts, 1 to 64 (default: 1,2,4,8,16,32,64)\n"
+              << "  --rate N          reloads per second, 0 for none (default: 100)\n"
+              << "  --duration MS     length of each run (default: 1000)\n"
+              << "  --keys N          filler keys besides the one being read (default: 1000)\n"
+              << "  --sample N        time every N-th read, 0 disables (default: 16)\n"
+              << "  --format FMT      table or csv (default: table)\n"
+              << "LIST is comma separated, e.g. --threads 1,4,16\n";
+}
+
+template<typename T>
+std::vector<T> parse_list(const std::string& arg) {
+    std::vector<T> values;
+    std::stringstream ss(arg);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        if (token.empty()) continue;
+        if constexpr (std::is_same_v<T, std::string>) {
+            values.push_back(token);
+        } else {
+            size_t used = 0;
+            unsigned long long v = std::stoull(token, &used);
+            if (used != token.size()) throw std::invalid_argument(token);
+            values.push_back((T)v);
+        }
+    }
+    if (values.empty()) throw std::invalid_argument(arg);
+    return values;
+}
+
+// Fills opt from argv; returns false (after printing why) on bad input
+bool parse_options(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        try {
+            if (arg == "--impl") opt.impls = parse_list<std::string>(value());
+            else if (arg == "--threads") opt.threads = parse_list<int>(value());
+            else if (arg == "--rate") opt.rate = parse_list<unsigned>(value()).at(0);
+            else if (arg == "--duration") opt.duration_ms = parse_list<unsigned>(value()).at(0);
+            else if (arg == "--keys") opt.keys = parse_list<size_t>(value()).at(0);
+            else if (arg == "--sample") opt.sample_every = parse_list<size_t>(value()).at(0);
+            else if (arg == "--format") opt.format = value();
+            else if (arg == "--help" || arg == "-h") { print_usage(argv[0]); std::exit(0); }
+            else throw std::invalid_argument("unknown option " + arg);
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid argument: " << e.what() << "\n";
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    for (const auto& impl : opt.impls) {
+        if (impl != "manager" && impl != "shared_mutex") {
+            std::cerr << "Unknown implementation: " << impl << "\n";
+            return false;
+        }
+    }
+    if (!std::all_of(opt.threads.begin(), opt.threads.end(), [](int n) { return n >= 1 && n <= 64; })) {
+        std::cerr << "Reader thread counts must be between 1 and 64\n";
+        return false;
+    }
+    if (opt.duration_ms == 0) {
+        std::cerr << "--duration must be positive\n";
+        return false;
+    }
+    if (opt.format != "table" && opt.format != "csv") {
+        std::cerr << "Unknown format: " << opt.format << "\n";
+        return false;
+    }
+    return true;
+}
+
+template<typename Impl>
+void sweep(Impl& impl, const Options& opt, const std::string& name, std::ostream& out) {
+    int next = 1;  // First value of the next run; values only grow
+    for (int readers : opt.threads) {
+        RunResult r = run(impl, opt, readers, next);
+        next += r.reloads;
+        report_row(opt, out, name, readers, r);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_options(argc, argv, opt)) return 1;
+
+    // Results go to the original stdout; the manager logs every reload to
+    // std::cout, which is muted while the benchmark runs
+    std::ostream out(std::cout.rdbuf());
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    report_header(opt, out);
+    for (const auto& name : opt.impls) {
+        if (name == "manager") {
+            ManagerImpl impl(opt.keys);
+            sweep(impl, opt, name, out);
+            ConfigurationManager::getInstance().waitForObservers();
+        } else {
+            SharedMutexImpl impl(opt.keys);
+            sweep(impl, opt, name, out);
+        }
+    }
+    std::cout.rdbuf(console);
+    return 0;
+}
@@ -1,196 +1,21 @@
+#include "config_manager.hpp"
 #include <iostream>
-#include <string>
-#include <vector>
-#include <unordered_map>
 #include <memory>
-#include <variant>
-#include <functional>
-#include <mutex>
-#include <shared_mutex>
-#include <thread>
+#include <string>
 #include <chrono>
-
-// --- Data Types ---
-using ConfigValue = std::variant<int, double, bool, std::string>;
-
-// Helper to print ConfigValue
-struct ValuePrinter {
-    void operator()(int v) const { std::cout << v; }
-    void operator()(double v) const { std::cout << v; }
-    void operator()(bool v) const { std::cout << (v ? "true" : "false"); }
-    void operator()(const std::string& v) const { std::cout << v; }
-};
-
-void printValue(const ConfigValue& v) {
-    std::visit(ValuePrinter{}, v);
-}
-
-// --- Interfaces ---
-
-// Validator Interface
-class IValidator {
-public:
-    virtual bool validate(const std::string& key, const ConfigValue& value) = 0;
-    virtual ~IValidator() = default;
-};
-
-// Source Interface
-class IConfigSource {
-public:
-    virtual ~IConfigSource() = default;
-    virtual std::unordered_map<std::string, ConfigValue> load() = 0;
-    virtual void watch(std::function<void()> onChangeCallback) = 0;
-};
-
-// Observer Interface
-class IConfigObserver {
-public:
-    virtual void onConfigChanged(const std::string& key) = 0;
-    virtual ~IConfigObserver() = default;
-};
-
-// --- Implementations ---
-
-// Range Validator
-class RangeValidator : public IValidator {
-private:
-    int min, max;
-public:
-    RangeValidator(int minVal, int maxVal) : min(minVal), max(maxVal) {}
-    bool validate(const std::string& key, const ConfigValue& value) override {
-        if (std::holds_alternative<int>(value)) {
-            int v = std::get<int>(value);
-            return v >= min && v <= max;
-        }
-        return true; // Pass if type doesn't match (simplification)
-    }
-};
-
-// Mock Source (Simulates a file or DB)
-class MockSource : public IConfigSource {
-private:
-    std::unordered_map<std::string, ConfigValue> data;
-    std::function<void()> callback;
-public:
-    MockSource() {
-        data["max_connections"] = 100;
-        data["app_name"] = std::string("MyApp");
-        data["debug_mode"] = true;
-    }
-
-    std::unordered_map<std::string, ConfigValue> load() override {
-        return data;
-    }
-
-    void watch(std::function<void()> onChangeCallback) override {
-        callback = onChangeCallback;
-    }
-
-    // Method to simulate external change
-    void updateData(const std::string& key, ConfigValue value) {
-        data[key] = value;
-        if (callback) {
-            std::cout << "[Source] Detected change. Triggering reload...\n";
-            callback();
-        }
-    }
-};
-
-// Configuration Manager
-class ConfigurationManager {
-private:
-    std::unordered_map<std::string, ConfigValue> configStore;
-    mutable std::shared_mutex mutex;
-    std::vector<std::shared_ptr<IConfigSource>> sources;
-    std::unordered_map<std::string, std::shared_ptr<IValidator>> validators;
-    std::vector<std::weak_ptr<IConfigObserver>> observers;
-
-    ConfigurationManager() = default;
-
-    void notifyObservers() {
-        std::cout << "[Manager] Notifying observers of update.\n";
-        for (auto it = observers.begin(); it != observers.end(); ) {
-            if (auto obs = it->lock()) {
-                obs->onConfigChanged("ALL"); // Simplified: notify all changed
-                ++it;
-            } else {
-                it = observers.erase(it);
-            }
-        }
-    }
-
-public:
-    static ConfigurationManager& getInstance() {
-        static ConfigurationManager instance;
-        return instance;
-    }
-
-    ConfigurationManager(const ConfigurationManager&) = delete;
-    ConfigurationManager& operator=(const ConfigurationManager&) = delete;
-
-    void addSource(std::shared_ptr<IConfigSource> source) {
-        sources.push_back(source);
-        source->watch([this]() {
-            this->reload();
-        });
-        reload();
-    }
-
-    void addValidator(const std::string& key, std::shared_ptr<IValidator> validator) {
-        validators[key] = validator;
-    }
-
-    void registerObserver(std::shared_ptr<IConfigObserver> observer) {
-        observers.push_back(observer);
-    }
-
-    void reload() {
-        std::unique_lock<std::shared_mutex> lock(mutex);
-        std::unordered_map<std::string, ConfigValue> newStore;
-
-        for (const auto& source : sources) {
-            auto data = source->load();
-            for (const auto& [key, value] : data) {
-                newStore[key] = value;
-            }
-        }
-
-        // Validation
-        for (const auto& [key, value] : newStore) {
-            if (validators.find(key) != validators.end()) {
-                if (!validators[key]->validate(key, value)) {
-                    std::cout << "[Manager] Validation Failed for key: " << key << ". Keeping old values.\n";
-                    return; // Abort reload on validation failure
-                }
-            }
-        }
-
-        configStore = std::move(newStore);
-        std::cout << "[Manager] Configuration reloaded successfully.\n";
-        
-        // Notify outside lock to avoid potential deadlocks if observer calls back
-        lock.unlock(); 
-        notifyObservers();
-    }
-
-    template <typename T>
-    T getValue(const std::string& key, T defaultValue) const {
-        std::shared_lock<std::shared_mutex> lock(mutex);
-        if (configStore.find(key) != configStore.end()) {
-            if (std::holds_alternative<T>(configStore.at(key))) {
-                return std::get<T>(configStore.at(key));
-            }
-        }
-        return defaultValue;
-    }
-};
+#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
 
 // Example Observer
 class LoggerService : public IConfigObserver {
 public:
-    void onConfigChanged(const std::string& key) override {
+    void onConfigChanged(const ConfigUpdate& update) override {
         bool debug = ConfigurationManager::getInstance().getValue<bool>("debug_mode", false);
-        std::cout << "[LoggerService] Config changed. Debug mode is now: " << (debug ? "ON" : "OFF") << "\n";
+        std::cout << "[LoggerService] v" << update.version << " changed";
+        for (const auto& key : update.keys) std::cout << " " << key;
+        std::cout << ". Debug mode is now: " << (debug ? "ON" : "OFF") << "\n";
     }
 };
 
@@ -204,21 +29,38 @@ int main() {
     auto mockSource = std::make_shared<MockSource>();
     config.addSource(mockSource);
 
-    // 3. Register Observer
+    // 3. Register Observer (only for the key it cares about)
     auto logger = std::make_shared<LoggerService>();
-    config.registerObserver(logger);
+    config.subscribe("debug_mode", logger);
 
     // 4. Initial Read
     std::cout << "\n--- Initial State ---\n";
     std::cout << "App Name: " << config.getValue<std::string>("app_name", "DefaultApp") << "\n";
     std::cout << "Max Conn: " << config.getValue<int>("max_connections", 0) << "\n";
 
+    // Hot-path readers bind once; mistakes surface here, not as silent defaults
+    auto maxConnections = config.bind<int>("max_connections", 0);
+    auto appName = config.bind<std::string>("app_name", "");
+    try {
+        config.bind<int>("max_conections", 0);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "Bind failed: " << e.what() << "\n";
+    }
+    try {
+        config.bind<int>("app_name", 0);
+    } catch (const std::invalid_argument& e) {
+        std::cout << "Bind failed: " << e.what() << "\n";
+    }
+
     // 5. Simulate Hot Reload (Valid Update)
     std::cout << "\n--- Updating Config (Valid) ---\n";
     mockSource->updateData("max_connections", 500);
     mockSource->updateData("debug_mode", false);
+    config.waitForObservers(); // Observers run on the notification thread
     
     std::cout << "Max Conn (Updated): " << config.getValue<int>("max_connections", 0) << "\n";
+    std::cout << "Max Conn (Handle):  " << maxConnections.get() << "\n";
+    std::cout << "App Name (Handle):  " << *appName.get() << "\n";
 
     // 6. Simulate Hot Reload (Invalid Update - Validation Fail)
     std::cout << "\n--- Updating Config (Invalid) ---\n";
@@ -227,5 +69,97 @@ int main() {
     // Value should remain 500
     std::cout << "Max Conn (After Invalid): " << config.getValue<int>("max_connections", 0) << "\n";
 
+    // 7. File Source (edited by replacing the file, as most editors do)
+    std::cout << "\n--- File Source ---\n";
+    auto iniPath = std::filesystem::temp_directory_path() / "config_manager_demo.ini";
+    auto writeIni = [&iniPath](const std::string& text) {
+        auto tmp = iniPath;
+        tmp += ".tmp";
+        std::ofstream(tmp) << text;
+        std::filesystem::rename(tmp, iniPath);
+    };
+    writeIni("[db]\nhost = \"localhost\"\nport = 5432\n");
+    config.addSource(std::make_shared<FileConfigSource>(iniPath.string()));
+    std::cout << "DB: " << config.getValue<std::string>("db.host", "") << ":" << config.getValue<int>("db.port", 0) << "\n";
+    auto dbWatcher = std::make_shared<LoggerService>();
+    config.subscribe("db.*", dbWatcher);
+
+    writeIni("[db]\nhost = \"localhost\"\nport = 6432 # moved\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Debounce + reload
+    config.waitForObservers();
+    std::cout << "DB section:";
+    for (const auto& [key, value] : config.getSection("db")) {
+        std::cout << " " << key << "=";
+        printValue(value);
+    }
+    std::cout << "\n";
+    std::filesystem::remove(iniPath);
+
+    // 8. Precedence Layers (defaults < file < env < runtime), loaded concurrently
+    std::cout << "\n--- Precedence Layers ---\n";
+    setenv("APP_DB__POOL__MAX", "20", 1);
+    auto defaults = std::make_shared<MockSource>(); // Also defaults max_connections to 100
+    defaults->updateData("db.pool.max", 10);
+    defaults->updateData("db.pool.min", 2);
+    config.addSources({{defaults, Precedence::Defaults},
+                       {std::make_shared<EnvConfigSource>("APP_"), Precedence::Environment}});
+    config.waitForObservers();
+    std::cout << "Pool: min " << config.getValue<int>("db.pool.min", 0) << " (defaults), max "
+              << config.getValue<int>("db.pool.max", 0) << " (env). Max Conn: "
+              << config.getValue<int>("max_connections", 0) << " (file beats defaults)\n";
+
+    // 9. Consistent Reads (one view per request)
+    std::cout << "\n--- Snapshot View ---\n";
+    auto view = config.snapshot();
+    mockSource->updateData("max_connections", 750);
+    auto age = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - view.loadedAt());
+    std::cout << "View v" << view.version() << " (loaded " << age.count() << " ms ago): Max Conn " << view.getValue<int>("max_connections", 0)
+              << ", Debug " << (view.getValue<bool>("debug_mode", false) ? "ON" : "OFF") << "\n";
+    std::cout << "Live v" << config.snapshot().version() << ": Max Conn " << config.getValue<int>("max_connections", 0) << "\n";
+
+    // 10. Schema (compiled once; a reload reports every broken rule)
+    std::cout << "\n--- Schema ---\n";
+    ConfigSchema schema;
+    schema.key("max_connections").type<int>().range(1, 1000).require();
+    schema.key("debug_mode").type<bool>();
+    schema.key("app_name").pattern("[A-Za-z][A-Za-z0-9]*");
+    schema.key("db.pool.min").type<int>().range(0, 40);
+    schema.constraint({"db.pool.min", "db.pool.max"},
+                      [](const std::vector<const ConfigValue*>& v) {
+                          const int* min = v[0] ? std::get_if<int>(v[0]) : nullptr;
+                          const int* max = v[1] ? std::get_if<int>(v[1]) : nullptr;
+                          return !min || !max || *min <= *max;
+                      },
+                      "pool min must not exceed pool max");
+    config.setSchema(std::move(schema));
+    defaults->updateData("db.pool.min", 50);
+    std::cout << "Pool min (After Invalid): " << config.getValue<int>("db.pool.min", 0) << "\n";
+
+    // 11. Audit Log and Rollback (a bad push reverted without touching sources)
+    std::cout << "\n--- Audit Log and Rollback ---\n";
+    uint64_t good = config.snapshot().version();
+    mockSource->updateData("max_connections", 5);
+    std::cout << "Max Conn (Bad Push): " << config.getValue<int>("max_connections", 0) << "\n";
+    config.rollback(good);
+    config.waitForObservers();
+    std::cout << "Max Conn (Rolled Back): " << config.getValue<int>("max_connections", 0) << " (Handle: "
+              << maxConnections.get() << ")\n";
+    for (const auto& entry : config.auditLog()) {
+        std::cout << "v" << entry.version << " " << entry.action;
+        for (const auto& source : entry.sources) std::cout << " [" << source << "]";
+        std::cout << ":";
+        for (const auto& key : entry.keys) std::cout << " " << key;
+        std::cout << "\n";
+    }
+
+    // 12. Binary Snapshot (exported, then served straight from the mapping)
+    std::cout << "\n--- Binary Snapshot ---\n";
+    auto snapPath = (std::filesystem::temp_directory_path() / "config_manager_demo.snap").string();
+    config.exportSnapshot(snapPath);
+    MappedSnapshot snap(snapPath);
+    std::cout << "Snapshot v" << snap.version() << ", " << snap.size() << " keys. App Name: " << snap.getString("app_name")
+              << ", Max Conn: " << snap.getValue<int>("max_connections", 0) << "\n";
+    std::filesystem::remove(snapPath);
+
     return 0;
 }
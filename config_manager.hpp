@@ -0,0 +1,2488 @@
+#pragma once
+
+// Hot-reloadable configuration: sources layered by precedence, snapshots
+// published lock-free and read through flat perfect-hash tables, observers
+// notified on their own thread. The demo is config_manager.cpp; the read-path
+// benchmark is config_benchmark.cpp.
+
+#include "concurrency/UnboundedQueue.hpp"
+#include "concurrency/WaitableQueue.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <variant>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <string_view>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdlib>
+#include <array>
+#include <future>
+#include <regex>
+#include <sstream>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+// --- Data Types ---
+using ConfigValue = std::variant<int, double, bool, std::string>;
+
+// Helper to print ConfigValue
+struct ValuePrinter {
+    void operator()(int v) const { std::cout << v; }
+    void operator()(double v) const { std::cout << v; }
+    void operator()(bool v) const { std::cout << (v ? "true" : "false"); }
+    void operator()(const std::string& v) const { std::cout << v; }
+};
+
+inline void printValue(const ConfigValue& v) {
+    std::visit(ValuePrinter{}, v);
+}
+
+template <typename T>
+constexpr bool isConfigType = std::is_same_v<T, int> || std::is_same_v<T, double> ||
+                              std::is_same_v<T, bool> || std::is_same_v<T, std::string>;
+
+inline const char* valueTypeName(const ConfigValue& v) {
+    static const char* const names[] = {"int", "double", "bool", "string"};
+    return names[v.index()];
+}
+
+using ConfigLayer = std::unordered_map<std::string, ConfigValue>;
+
+// --- Flat Table ---
+
+// Layout of a flat config table, used both for published snapshots and for
+// binary snapshot files, in host byte order:
+//
+//   Header | displacements (uint32 per bucket) | key order (uint32 per key)
+//          | entries | string table
+//
+// Keys are placed with a minimal perfect hash (hash and displace): a key's
+// hash picks a bucket, the bucket's displacement picks the key's entry
+// slot. Each entry is one cache line holding the typed value and, when they
+// fit, the key and string value bytes, so a lookup usually touches just one
+// displacement and one entry. Longer keys and strings go to the string table.
+// The key order lists entry slots sorted by key, so all keys under a dotted
+// prefix form one contiguous, binary-searchable range.
+namespace snapshot_format {
+
+constexpr char MAGIC[8] = {'C', 'F', 'G', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr uint32_t FORMAT_VERSION = 3; // 2: cache-line entries, 3: key order
+constexpr size_t ENTRY_ALIGN = 64;
+constexpr uint32_t KEYS_PER_BUCKET = 4;
+constexpr uint32_t DIRECT_SLOT = 0x80000000u; // Displacement holds the slot itself
+
+struct Header {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t formatVersion;
+    uint64_t configVersion;
+    uint32_t keyCount;
+    uint32_t bucketCount;
+    uint64_t orderOffset;
+    uint64_t entriesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t totalSize;
+};
+
+constexpr uint32_t INLINE_BYTES = 40;
+// Entry type marking a removed key. Only overlays in memory use it (see
+// ConfigSnapshot); exported files hold values only.
+constexpr uint32_t TOMBSTONE = 4;
+
+// The key is inline if it fits in INLINE_BYTES; a string value is inline,
+// after an inline key, if both fit. Otherwise they are in the string table.
+struct alignas(ENTRY_ALIGN) Entry {
+    uint32_t keyLength;
+    uint32_t type;        // ConfigValue::index(), or TOMBSTONE
+    uint64_t value;       // int/bool value, double bits, or string offset
+    uint32_t valueLength; // String values only
+    uint32_t keyOffset;   // Into the string table, for long keys
+    char inlineBytes[INLINE_BYTES];
+};
+
+static_assert(sizeof(Header) % 8 == 0, "displacements must stay aligned");
+static_assert(sizeof(Entry) == ENTRY_ALIGN, "one entry per cache line");
+
+inline bool keyInline(const Entry& e) { return e.keyLength <= INLINE_BYTES; }
+
+inline uint32_t inlineKeyBytes(const Entry& e) { return keyInline(e) ? e.keyLength : 0; }
+
+inline bool valueInline(const Entry& e) { return inlineKeyBytes(e) + uint64_t(e.valueLength) <= INLINE_BYTES; }
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Maps x uniformly onto [0, n) with a multiply instead of a division
+inline uint32_t reduce(uint64_t x, uint32_t n) {
+    return static_cast<uint32_t>((static_cast<unsigned __int128>(x) * n) >> 64);
+}
+
+// Eight bytes per step, then one full mix
+inline uint64_t keyHash(std::string_view key) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ key.size();
+    const char* p = key.data();
+    size_t n = key.size();
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    if (n > 0) {
+        uint64_t w = 0;
+        std::memcpy(&w, p, n);
+        h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 32;
+    }
+    return mix64(h);
+}
+
+inline uint32_t bucketOf(uint64_t hash, uint32_t bucketCount) {
+    return reduce(hash, bucketCount);
+}
+
+inline uint32_t slotOf(uint64_t hash, uint32_t displacement, uint32_t keyCount) {
+    if (displacement & DIRECT_SLOT) return displacement & ~DIRECT_SLOT;
+    // Low bits, so slots are independent of the high bits that chose the bucket
+    return reduce(((hash ^ displacement) * 0x9E3779B97F4A7C15ULL) << 32 | (hash >> 32), keyCount);
+}
+
+} // namespace snapshot_format
+
+// Heap allocator aligned for Entry, so an in-memory table keeps each
+// entry on its own cache line just like a mapped file does
+template <typename T>
+struct EntryAlignedAllocator {
+    using value_type = T;
+
+    EntryAlignedAllocator() = default;
+    template <typename U>
+    EntryAlignedAllocator(const EntryAlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(snapshot_format::ENTRY_ALIGN)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(snapshot_format::ENTRY_ALIGN)); }
+
+    template <typename U>
+    bool operator==(const EntryAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const EntryAlignedAllocator<U>&) const { return false; }
+};
+
+using FlatBytes = std::vector<char, EntryAlignedAllocator<char>>;
+
+// Serialises values, plus a tombstone for each removed key (which must not
+// also be in values), into the snapshot layout. Throws std::length_error if
+// the table would not fit the format's 32-bit counts and offsets.
+inline FlatBytes buildFlatTable(const ConfigLayer& values, uint64_t configVersion,
+                                const std::vector<std::string>& removed = {}) {
+    namespace fmt = snapshot_format;
+    if (values.size() + removed.size() >= fmt::DIRECT_SLOT) throw std::length_error("Too many config keys for a snapshot");
+    uint32_t n = static_cast<uint32_t>(values.size() + removed.size());
+    uint32_t buckets = n == 0 ? 0 : (n + fmt::KEYS_PER_BUCKET - 1) / fmt::KEYS_PER_BUCKET;
+
+    // Group keys by bucket
+    struct Item {
+        const std::string* key;
+        const ConfigValue* value; // nullptr for a tombstone
+    };
+    std::vector<Item> items;
+    std::vector<uint64_t> hashes;
+    items.reserve(n);
+    hashes.reserve(n);
+    std::vector<std::vector<uint32_t>> bucketItems(buckets);
+    auto addItem = [&](const std::string& key, const ConfigValue* value) {
+        uint64_t h = fmt::keyHash(key);
+        bucketItems[fmt::bucketOf(h, buckets)].push_back(static_cast<uint32_t>(items.size()));
+        items.push_back({&key, value});
+        hashes.push_back(h);
+    };
+    for (const auto& kv : values) addItem(kv.first, &kv.second);
+    for (const auto& key : removed) addItem(key, nullptr);
+
+    // Place the largest buckets first, while most slots are still free,
+    // searching for a displacement that sends all their keys to free slots.
+    // Single-key buckets go last and simply take any free slot directly.
+    std::vector<uint32_t> order(buckets);
+    for (uint32_t b = 0; b < buckets; ++b) order[b] = b;
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return bucketItems[a].size() > bucketItems[b].size(); });
+    std::vector<uint32_t> displacements(buckets, 0);
+    std::vector<uint32_t> keyOrder(n);
+    std::vector<uint32_t> slotOfItem(n);
+    std::vector<bool> taken(n, false);
+    std::vector<uint32_t> trial;
+    uint32_t nextFree = 0;
+    for (uint32_t b : order) {
+        const auto& members = bucketItems[b];
+        if (members.empty()) break;
+        if (members.size() == 1) {
+            while (taken[nextFree]) ++nextFree;
+            taken[nextFree] = true;
+            slotOfItem[members[0]] = nextFree;
+            displacements[b] = fmt::DIRECT_SLOT | nextFree;
+            continue;
+        }
+        for (uint32_t d = 1;; ++d) {
+            if (d == fmt::DIRECT_SLOT) throw std::length_error("No perfect hash found for snapshot");
+            trial.clear();
+            bool ok = true;
+            for (uint32_t item : members) {
+                uint32_t slot = fmt::slotOf(hashes[item], d, n);
+                if (taken[slot] || std::find(trial.begin(), trial.end(), slot) != trial.end()) {
+                    ok = false;
+                    break;
+                }
+                trial.push_back(slot);
+            }
+            if (!ok) continue;
+            for (size_t i = 0; i < members.size(); ++i) {
+                taken[trial[i]] = true;
+                slotOfItem[members[i]] = trial[i];
+            }
+            displacements[b] = d;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; ++i) keyOrder[i] = i;
+    std::sort(keyOrder.begin(), keyOrder.end(), [&](uint32_t a, uint32_t b) { return *items[a].key < *items[b].key; });
+    for (auto& item : keyOrder) item = slotOfItem[item];
+
+    // Entries and string table
+    std::vector<fmt::Entry> entries(n, fmt::Entry{});
+    std::string strings;
+    auto addString = [&strings](std::string_view s) {
+        if (strings.size() + s.size() > UINT32_MAX) throw std::length_error("Snapshot string table too large");
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(s);
+        return offset;
+    };
+    for (uint32_t i = 0; i < n; ++i) {
+        const std::string& key = *items[i].key;
+        fmt::Entry& e = entries[slotOfItem[i]];
+        e.keyLength = static_cast<uint32_t>(key.size());
+        if (fmt::keyInline(e)) {
+            std::memcpy(e.inlineBytes, key.data(), key.size());
+        } else {
+            e.keyOffset = addString(key);
+        }
+        e.valueLength = 0;
+        e.value = 0;
+        if (!items[i].value) {
+            e.type = fmt::TOMBSTONE;
+            continue;
+        }
+        const ConfigValue& value = *items[i].value;
+        e.type = static_cast<uint32_t>(value.index());
+        if (const int* v = std::get_if<int>(&value)) {
+            e.value = static_cast<uint64_t>(static_cast<int64_t>(*v));
+        } else if (const double* v = std::get_if<double>(&value)) {
+            std::memcpy(&e.value, v, sizeof(double));
+        } else if (const bool* v = std::get_if<bool>(&value)) {
+            e.value = *v;
+        } else {
+            const auto& str = std::get<std::string>(value);
+            if (str.size() > UINT32_MAX) throw std::length_error("Config string value too large");
+            e.valueLength = static_cast<uint32_t>(str.size());
+            if (fmt::valueInline(e)) {
+                std::memcpy(e.inlineBytes + fmt::inlineKeyBytes(e), str.data(), str.size());
+            } else {
+                e.value = addString(str);
+            }
+        }
+    }
+
+    fmt::Header header{};
+    std::memcpy(header.magic, fmt::MAGIC, sizeof(header.magic));
+    header.byteOrder = fmt::BYTE_ORDER_MARK;
+    header.formatVersion = fmt::FORMAT_VERSION;
+    header.configVersion = configVersion;
+    header.keyCount = n;
+    header.bucketCount = buckets;
+    header.orderOffset = sizeof(fmt::Header) + uint64_t(buckets) * sizeof(uint32_t);
+    header.entriesOffset = (header.orderOffset + uint64_t(n) * sizeof(uint32_t) + fmt::ENTRY_ALIGN - 1) /
+                           fmt::ENTRY_ALIGN * fmt::ENTRY_ALIGN;
+    header.stringsOffset = header.entriesOffset + uint64_t(n) * sizeof(fmt::Entry);
+    header.stringsSize = strings.size();
+    header.totalSize = header.stringsOffset + strings.size();
+
+    FlatBytes out(header.totalSize, 0);
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), displacements.data(), buckets * sizeof(uint32_t));
+    std::memcpy(out.data() + header.orderOffset, keyOrder.data(), n * sizeof(uint32_t));
+    std::memcpy(out.data() + header.entriesOffset, entries.data(), n * sizeof(fmt::Entry));
+    std::memcpy(out.data() + header.stringsOffset, strings.data(), strings.size());
+    return out;
+}
+
+// Read-only view of a table in the snapshot layout, over memory it does not
+// own (a mapped file or a buffer). Lookups read the bytes in place. The
+// header is checked up front; entries are bounds-checked as they are read,
+// so opening stays O(1) however many keys there are.
+class FlatConfigTable {
+private:
+    const char* base = nullptr;
+    const snapshot_format::Header* header = nullptr;
+    const uint32_t* displacements = nullptr;
+    const uint32_t* keyOrder = nullptr;
+    const snapshot_format::Entry* entries = nullptr;
+    const char* strings = nullptr;
+
+    std::string_view stringAt(uint64_t offset, uint64_t length) const {
+        // Subtracted, so offsets read from the file cannot wrap past the check
+        if (offset > header->stringsSize || length > header->stringsSize - offset) {
+            throw std::runtime_error("Corrupt config snapshot entry");
+        }
+        return {strings + offset, static_cast<size_t>(length)};
+    }
+
+    std::string_view stringValue(const snapshot_format::Entry& e) const {
+        if (snapshot_format::valueInline(e)) return {e.inlineBytes + snapshot_format::inlineKeyBytes(e), e.valueLength};
+        return stringAt(e.value, e.valueLength);
+    }
+
+public:
+    using Entry = snapshot_format::Entry;
+
+    FlatConfigTable() = default;
+
+    // Throws std::runtime_error unless data holds a well-formed header
+    // whose sections lie within size bytes
+    FlatConfigTable(const char* data, size_t size) : base(data) {
+        namespace fmt = snapshot_format;
+        if (size < sizeof(fmt::Header)) throw std::runtime_error("Config snapshot truncated");
+        header = reinterpret_cast<const fmt::Header*>(data);
+        if (std::memcmp(header->magic, fmt::MAGIC, sizeof(fmt::MAGIC)) != 0) {
+            throw std::runtime_error("Not a config snapshot");
+        }
+        if (header->byteOrder != fmt::BYTE_ORDER_MARK) throw std::runtime_error("Config snapshot has foreign byte order");
+        if (header->formatVersion != fmt::FORMAT_VERSION) {
+            throw std::runtime_error("Unsupported config snapshot format " + std::to_string(header->formatVersion));
+        }
+        // Every section must lie in [0, size). Bounds are checked by
+        // subtraction, so offsets from a corrupt file cannot wrap around;
+        // counts are 32-bit, so their byte lengths cannot overflow.
+        auto within = [size](uint64_t offset, uint64_t length) { return offset <= size && length <= size - offset; };
+        uint64_t orderBytes = uint64_t(header->keyCount) * sizeof(uint32_t);
+        uint64_t entryBytes = uint64_t(header->keyCount) * sizeof(Entry);
+        bool fits = header->totalSize == size && header->entriesOffset % snapshot_format::ENTRY_ALIGN == 0 &&
+                    header->orderOffset == sizeof(fmt::Header) + uint64_t(header->bucketCount) * sizeof(uint32_t) &&
+                    within(header->orderOffset, orderBytes) &&
+                    within(header->entriesOffset, entryBytes) &&
+                    within(header->stringsOffset, header->stringsSize) &&
+                    header->orderOffset + orderBytes <= header->entriesOffset &&
+                    header->entriesOffset + entryBytes <= header->stringsOffset &&
+                    (header->keyCount == 0 || header->bucketCount > 0);
+        if (!fits) throw std::runtime_error("Corrupt config snapshot header");
+        displacements = reinterpret_cast<const uint32_t*>(data + sizeof(fmt::Header));
+        keyOrder = reinterpret_cast<const uint32_t*>(data + header->orderOffset);
+        entries = reinterpret_cast<const Entry*>(data + header->entriesOffset);
+        strings = data + header->stringsOffset;
+    }
+
+    size_t size() const { return header ? header->keyCount : 0; }
+    uint64_t version() const { return header ? header->configVersion : 0; }
+    const char* data() const { return base; }
+    size_t byteSize() const { return header ? header->totalSize : 0; }
+
+    // Entry for key, or nullptr. A miss costs the same as a hit: one
+    // displacement, one entry and one key comparison.
+    const Entry* find(std::string_view key) const {
+        if (size() == 0) return nullptr;
+        uint64_t h = snapshot_format::keyHash(key);
+        uint32_t d = displacements[snapshot_format::bucketOf(h, header->bucketCount)];
+        uint32_t slot = snapshot_format::slotOf(h, d, header->keyCount);
+        if (slot >= header->keyCount) return nullptr;
+        const Entry& e = entries[slot];
+        return keyOf(e) == key ? &e : nullptr;
+    }
+
+    // Entry of the rank-th key in sorted order
+    const Entry& sorted(size_t rank) const {
+        uint32_t slot = keyOrder[rank];
+        if (slot >= header->keyCount) throw std::runtime_error("Corrupt config snapshot key order");
+        return entries[slot];
+    }
+
+    // Calls fn(entry) for every key starting with prefix, in key order.
+    // One binary search over the key order, then only the matches.
+    template <typename Fn>
+    void forEachWithPrefix(std::string_view prefix, Fn&& fn) const {
+        size_t lo = 0, hi = size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (keyOf(sorted(mid)) < prefix) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (; lo < size(); ++lo) {
+            const Entry& e = sorted(lo);
+            if (keyOf(e).substr(0, prefix.size()) != prefix) break;
+            fn(e);
+        }
+    }
+
+    std::string_view keyOf(const Entry& e) const {
+        if (snapshot_format::keyInline(e)) return {e.inlineBytes, e.keyLength};
+        return stringAt(e.keyOffset, e.keyLength);
+    }
+
+    bool removed(const Entry& e) const { return e.type == snapshot_format::TOMBSTONE; }
+
+    // String value in place; only valid while the table's memory is
+    std::optional<std::string_view> stringOf(const Entry& e) const {
+        if (e.type != 3) return std::nullopt;
+        return stringValue(e);
+    }
+
+    ConfigValue valueOf(const Entry& e) const {
+        switch (e.type) {
+        case 0: return static_cast<int>(static_cast<int64_t>(e.value));
+        case 1: {
+            double d;
+            std::memcpy(&d, &e.value, sizeof(d));
+            return d;
+        }
+        case 2: return e.value != 0;
+        case 3: return std::string(stringValue(e));
+        default: throw std::runtime_error("Corrupt config snapshot value type");
+        }
+    }
+
+    // Value of key if present with type T; T is one of the ConfigValue types
+    template <typename T>
+    std::optional<T> get(std::string_view key) const {
+        const Entry* e = find(key);
+        return e ? as<T>(*e) : std::nullopt;
+    }
+
+    // Entry's value if it holds a T. Decodes straight from the entry
+    // without going through ConfigValue.
+    template <typename T>
+    std::optional<T> as(const Entry& entry) const {
+        static_assert(isConfigType<T>, "T must be one of the ConfigValue types");
+        const Entry* e = &entry;
+        if constexpr (std::is_same_v<T, int>) {
+            if (e->type == 0) return static_cast<int>(static_cast<int64_t>(e->value));
+        } else if constexpr (std::is_same_v<T, double>) {
+            if (e->type == 1) {
+                double d;
+                std::memcpy(&d, &e->value, sizeof(d));
+                return d;
+            }
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (e->type == 2) return e->value != 0;
+        } else {
+            if (e->type == 3) return std::string(stringValue(*e));
+        }
+        return std::nullopt;
+    }
+
+    // Decodes every entry (the deserialising path, for layering)
+    ConfigLayer toLayer() const {
+        ConfigLayer out;
+        out.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            if (!removed(entries[i])) out.emplace(std::string(keyOf(entries[i])), valueOf(entries[i]));
+        }
+        return out;
+    }
+};
+
+// Precedence of a source's values: a key set at a higher level hides the
+// same key at every lower one. Sources at the same level override each
+// other in the order they were added.
+enum class Precedence { Defaults, File, Environment, Runtime };
+constexpr size_t PRECEDENCE_LEVELS = 4;
+
+// All sources of one precedence level merged and laid out flat
+struct LevelTable {
+    FlatBytes bytes;
+    FlatConfigTable flat; // Points into bytes
+
+    LevelTable() = default;
+    LevelTable(const LevelTable&) = delete; // flat would point into the original
+    LevelTable& operator=(const LevelTable&) = delete;
+
+    LevelTable(const ConfigLayer& values, uint64_t version, const std::vector<std::string>& removed = {})
+        : bytes(buildFlatTable(values, version, removed)), flat(bytes.data(), bytes.size()) {}
+
+    // Shared table with no keys
+    static const std::shared_ptr<const LevelTable>& empty() {
+        static const auto table = std::make_shared<const LevelTable>();
+        return table;
+    }
+};
+
+// One precedence level of a snapshot: a full table, shared by every snapshot
+// since it was built, and an overlay holding only the keys changed since
+// then (removed keys as tombstones). A reload rebuilds just the overlay;
+// once that outgrows a fraction of the base, the two are compacted into a
+// new base. So a version costs the keys changed since the last compaction,
+// not a copy of the level.
+struct Level {
+    std::shared_ptr<const LevelTable> base = LevelTable::empty();
+    std::shared_ptr<const LevelTable> overlay = LevelTable::empty();
+};
+
+// What one source contributed, as a persistent hash array mapped trie:
+// keys are placed by 5-bit slices of their hash, and each node stores only
+// its occupied slots. set() and erase() return a new layer that copies the
+// nodes on the path to the key (at most 13) and shares all the others, so
+// snapshots whose layers differ by a few keys cost a few nodes each.
+class PersistentLayer {
+private:
+    static constexpr unsigned BITS = 5;
+    static constexpr uint64_t SLOT_MASK = (1u << BITS) - 1;
+
+    struct Node;
+    // Keys whose whole hash is equal, almost always just one
+    struct Leaf {
+        uint64_t hash;
+        std::vector<std::pair<std::string, ConfigValue>> entries;
+    };
+    struct Slot { // Exactly one of the two is set
+        std::shared_ptr<const Node> node;
+        std::shared_ptr<const Leaf> leaf;
+    };
+    struct Node {
+        uint32_t bitmap = 0; // Bit i set if slice value i has a slot
+        std::vector<Slot> slots; // One per set bit, in bit order
+    };
+
+    std::shared_ptr<const Node> root;
+    size_t count = 0;
+
+    static uint64_t hashOf(std::string_view key) { return std::hash<std::string_view>{}(key); }
+
+    static uint32_t bitAt(uint64_t hash, unsigned shift) { return 1u << ((hash >> shift) & SLOT_MASK); }
+
+    static size_t slotIndex(const Node& node, uint32_t bit) {
+        return static_cast<size_t>(__builtin_popcount(node.bitmap & (bit - 1)));
+    }
+
+    static std::shared_ptr<const Node> insert(const Node* node, unsigned shift, uint64_t hash, const std::string& key,
+                                              const ConfigValue& value, bool& added) {
+        auto next = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        uint32_t bit = bitAt(hash, shift);
+        size_t pos = slotIndex(*next, bit);
+        if (!(next->bitmap & bit)) {
+            next->bitmap |= bit;
+            next->slots.insert(next->slots.begin() + pos, Slot{nullptr, std::make_shared<const Leaf>(Leaf{hash, {{key, value}}})});
+            added = true;
+            return next;
+        }
+        Slot& slot = next->slots[pos];
+        if (slot.node) {
+            slot.node = insert(slot.node.get(), shift + BITS, hash, key, value, added);
+        } else if (slot.leaf->hash == hash) {
+            auto leaf = std::make_shared<Leaf>(*slot.leaf);
+            auto it = std::find_if(leaf->entries.begin(), leaf->entries.end(), [&](const auto& e) { return e.first == key; });
+            if (it != leaf->entries.end()) {
+                it->second = value;
+            } else {
+                leaf->entries.emplace_back(key, value);
+                added = true;
+            }
+            slot.leaf = std::move(leaf);
+        } else {
+            // Two hashes share this slice: push the old leaf one level down.
+            // They differ somewhere, so some slice at or below 60 separates them.
+            Node child;
+            child.bitmap = bitAt(slot.leaf->hash, shift + BITS);
+            child.slots.push_back(Slot{nullptr, std::move(slot.leaf)});
+            slot.node = insert(&child, shift + BITS, hash, key, value, added);
+        }
+        return next;
+    }
+
+    // Node without key, or nullptr if it would be empty. A child left with
+    // a single leaf is replaced by that leaf.
+    static std::shared_ptr<const Node> remove(const std::shared_ptr<const Node>& node, unsigned shift, uint64_t hash,
+                                              const std::string& key, bool& removed) {
+        uint32_t bit = bitAt(hash, shift);
+        if (!(node->bitmap & bit)) return node;
+        size_t pos = slotIndex(*node, bit);
+        const Slot& slot = node->slots[pos];
+        Slot replacement;
+        if (slot.node) {
+            auto child = remove(slot.node, shift + BITS, hash, key, removed);
+            if (child == slot.node) return node;
+            if (child && child->slots.size() == 1 && child->slots[0].leaf) {
+                replacement.leaf = child->slots[0].leaf;
+            } else {
+                replacement.node = std::move(child);
+            }
+        } else {
+            if (slot.leaf->hash != hash) return node;
+            auto it = std::find_if(slot.leaf->entries.begin(), slot.leaf->entries.end(),
+                                   [&](const auto& e) { return e.first == key; });
+            if (it == slot.leaf->entries.end()) return node;
+            if (slot.leaf->entries.size() > 1) {
+                auto leaf = std::make_shared<Leaf>(*slot.leaf);
+                leaf->entries.erase(leaf->entries.begin() + (it - slot.leaf->entries.begin()));
+                replacement.leaf = std::move(leaf);
+            }
+        }
+        removed = true;
+        auto next = std::make_shared<Node>(*node);
+        if (replacement.node || replacement.leaf) {
+            next->slots[pos] = std::move(replacement);
+        } else {
+            next->bitmap &= ~bit;
+            next->slots.erase(next->slots.begin() + pos);
+            if (next->slots.empty()) return nullptr;
+        }
+        return next;
+    }
+
+    template <typename Fn>
+    static void forEach(const Node& node, Fn&& fn) {
+        for (const Slot& slot : node.slots) {
+            if (slot.node) {
+                forEach(*slot.node, fn);
+            } else {
+                for (const auto& [key, value] : slot.leaf->entries) fn(key, value);
+            }
+        }
+    }
+
+    // Calls fn with every key in a subtree of a or b whose node is not
+    // shared with the other. Shared subtrees are skipped by pointer.
+    template <typename Fn>
+    static void diffKeys(const Node* a, const Node* b, Fn& fn) {
+        if (a == b) return;
+        auto keysOf = [&fn](const Node* node) {
+            if (node) forEach(*node, [&fn](const std::string& key, const ConfigValue&) { fn(key); });
+        };
+        if (!a || !b) {
+            keysOf(a ? a : b);
+            return;
+        }
+        for (unsigned i = 0; i <= SLOT_MASK; ++i) {
+            uint32_t bit = 1u << i;
+            const Slot* sa = (a->bitmap & bit) ? &a->slots[slotIndex(*a, bit)] : nullptr;
+            const Slot* sb = (b->bitmap & bit) ? &b->slots[slotIndex(*b, bit)] : nullptr;
+            if (sa && sb && sa->node && sb->node) {
+                diffKeys(sa->node.get(), sb->node.get(), fn);
+                continue;
+            }
+            if (sa && sb && sa->leaf && sa->leaf == sb->leaf) continue;
+            for (const Slot* slot : {sa, sb}) {
+                if (!slot) continue;
+                if (slot->node) {
+                    keysOf(slot->node.get());
+                } else {
+                    for (const auto& entry : slot->leaf->entries) fn(entry.first);
+                }
+            }
+        }
+    }
+
+public:
+    size_t size() const { return count; }
+
+    // True if both are the same version of the layer (one shares the
+    // other's root), which is all a rollback needs to know
+    bool sameAs(const PersistentLayer& other) const { return root == other.root; }
+
+    const ConfigValue* find(std::string_view key) const {
+        uint64_t hash = hashOf(key);
+        const Node* node = root.get();
+        for (unsigned shift = 0; node; shift += BITS) {
+            uint32_t bit = bitAt(hash, shift);
+            if (!(node->bitmap & bit)) return nullptr;
+            const Slot& slot = node->slots[slotIndex(*node, bit)];
+            if (slot.node) {
+                node = slot.node.get();
+                continue;
+            }
+            if (slot.leaf->hash != hash) return nullptr;
+            for (const auto& [k, value] : slot.leaf->entries) {
+                if (k == key) return &value;
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    PersistentLayer set(const std::string& key, const ConfigValue& value) const {
+        PersistentLayer next;
+        bool added = false;
+        next.root = insert(root.get(), 0, hashOf(key), key, value, added);
+        next.count = count + (added ? 1 : 0);
+        return next;
+    }
+
+    PersistentLayer erase(const std::string& key) const {
+        if (!root) return *this;
+        PersistentLayer next;
+        bool removed = false;
+        next.root = remove(root, 0, hashOf(key), key, removed);
+        next.count = count - (removed ? 1 : 0);
+        return next;
+    }
+
+    // fn(key, value) for every entry, in no particular order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        if (root) forEach(*root, fn);
+    }
+
+    // fn(key) for every key that may differ between a and b (present in one
+    // only, or with values that may differ). Work is proportional to the
+    // nodes they do not share, not to their size; a key may be reported twice.
+    template <typename Fn>
+    static void forEachDifference(const PersistentLayer& a, const PersistentLayer& b, Fn fn) {
+        diffKeys(a.root.get(), b.root.get(), fn);
+    }
+};
+
+// Immutable state published by a reload. Readers only ever see a complete
+// snapshot; a reload builds a new one and swaps the pointer.
+struct ConfigSnapshot {
+    // One Level per Precedence level. Levels are not merged into one
+    // table: lookups fall through from Runtime down to Defaults, skipping
+    // empty tables, so a reload touches only the levels whose sources
+    // changed and shares the others with the previous snapshot.
+    std::array<Level, PRECEDENCE_LEVELS> levels;
+    // What each source contributed, by source index. Kept in the snapshot
+    // so a reload can diff against it without holding a lock, and shared
+    // structurally with the snapshots before and after it.
+    std::vector<PersistentLayer> layers;
+    uint64_t version = 0;
+    std::chrono::system_clock::time_point loadedAt{}; // When this version was published
+
+    // Entry that decides key's value and the table it is in, or nullptr.
+    // A level's overlay is probed before its base; a tombstone there hides
+    // the base entry and the lookup goes on to the next level down.
+    const FlatConfigTable::Entry* find(std::string_view key, const FlatConfigTable*& table) const {
+        for (size_t i = PRECEDENCE_LEVELS; i-- > 0; ) {
+            const FlatConfigTable& overlay = levels[i].overlay->flat;
+            if (overlay.size() != 0) {
+                if (const FlatConfigTable::Entry* e = overlay.find(key)) {
+                    if (overlay.removed(*e)) continue;
+                    table = &overlay;
+                    return e;
+                }
+            }
+            const FlatConfigTable& flat = levels[i].base->flat;
+            if (flat.size() == 0) continue;
+            if (const FlatConfigTable::Entry* e = flat.find(key)) {
+                table = &flat;
+                return e;
+            }
+        }
+        return nullptr;
+    }
+
+    // Effective value of key if it holds a T. A T-typed value at a lower
+    // level does not show through a differently typed one above it.
+    template <typename T>
+    std::optional<T> get(std::string_view key) const {
+        const FlatConfigTable* table = nullptr;
+        const FlatConfigTable::Entry* e = find(key, table);
+        return e ? table->as<T>(*e) : std::nullopt;
+    }
+
+    std::optional<ConfigValue> value(std::string_view key) const {
+        const FlatConfigTable* table = nullptr;
+        const FlatConfigTable::Entry* e = find(key, table);
+        if (!e) return std::nullopt;
+        return table->valueOf(*e);
+    }
+
+    // Every effective value under prefix, keyed by the rest of the key
+    ConfigLayer withPrefix(std::string_view prefix) const {
+        ConfigLayer out;
+        for (const auto& level : levels) { // Lowest first, so higher levels overwrite
+            const FlatConfigTable& base = level.base->flat;
+            const FlatConfigTable& overlay = level.overlay->flat;
+            base.forEachWithPrefix(prefix, [&](const FlatConfigTable::Entry& e) {
+                std::string_view key = base.keyOf(e);
+                if (overlay.size() != 0 && overlay.find(key)) return; // Changed or removed since the base
+                out.insert_or_assign(std::string(key.substr(prefix.size())), base.valueOf(e));
+            });
+            overlay.forEachWithPrefix(prefix, [&](const FlatConfigTable::Entry& e) {
+                if (overlay.removed(e)) return;
+                out.insert_or_assign(std::string(overlay.keyOf(e).substr(prefix.size())), overlay.valueOf(e));
+            });
+        }
+        return out;
+    }
+};
+
+// Changes a source reports since it was last read
+struct ConfigDelta {
+    std::unordered_map<std::string, ConfigValue> upserts;
+    std::unordered_set<std::string> removals;
+
+    bool empty() const { return upserts.empty() && removals.empty(); }
+};
+
+// --- Interfaces ---
+
+// Validator Interface
+class IValidator {
+public:
+    virtual bool validate(const std::string& key, const ConfigValue& value) = 0;
+    virtual ~IValidator() = default;
+};
+
+// Source Interface
+class IConfigSource {
+public:
+    virtual ~IConfigSource() = default;
+    virtual std::unordered_map<std::string, ConfigValue> load() = 0;
+    virtual void watch(std::function<void()> onChangeCallback) = 0;
+
+    // Changes since the last load() or loadDelta(). Sources that cannot
+    // track them return nullopt and are re-read with load() and diffed.
+    virtual std::optional<ConfigDelta> loadDelta() { return std::nullopt; }
+
+    // Who changed the configuration, as shown in the audit log
+    virtual std::string name() const { return "unnamed source"; }
+};
+
+// Observer Interface
+// What an observer is told: the keys it subscribed to that changed, as of
+// snapshot version. Updates queued for a busy observer are merged, so keys
+// may span several reloads; version is always the latest of them.
+struct ConfigUpdate {
+    uint64_t version = 0;
+    std::vector<std::string> keys; // Sorted, no duplicates
+};
+
+// Called on the manager's notification thread, never on the reloading one.
+// The ConfigUpdate overload is the one the manager calls and must be
+// overridden; the single-key form is kept for callers of the old interface.
+class IConfigObserver {
+public:
+    virtual void onConfigChanged(const ConfigUpdate& update) = 0;
+    virtual void onConfigChanged(const std::string& key) {
+        onConfigChanged(ConfigUpdate{0, {key}});
+    }
+    virtual ~IConfigObserver() = default;
+};
+
+// --- Bound Handles ---
+
+// Part of a handle that the manager refreshes after every reload
+class IBoundSlot {
+public:
+    virtual void refresh(const ConfigSnapshot& snapshot) = 0;
+    virtual const std::string& name() const = 0;
+    virtual ~IBoundSlot() = default;
+};
+
+// Cached value of one key. int, double and bool live in a std::atomic, so a
+// read is one lock-free atomic load. Strings are swapped as a shared_ptr and
+// get() hands out that pointer rather than a copy, but atomic shared_ptr
+// loads are not lock-free (libstdc++ guards them with a small pool of
+// mutexes), so string handles are cheap, not wait-free.
+template <typename T>
+class BoundSlot : public IBoundSlot {
+private:
+    static constexpr bool kInline = std::is_trivially_copyable_v<T>;
+
+public:
+    // What get() returns: the value itself, or a shared string
+    using Value = std::conditional_t<kInline, T, std::shared_ptr<const T>>;
+
+private:
+    std::string key;
+    T defaultValue;
+    std::conditional_t<kInline, std::atomic<T>, std::shared_ptr<const T>> cached{};
+
+public:
+    BoundSlot(std::string k, T def) : key(std::move(k)), defaultValue(std::move(def)) {}
+
+    // Falls back to the default if a reload removed the key or changed its type
+    void refresh(const ConfigSnapshot& snapshot) override {
+        std::optional<T> value = snapshot.get<T>(key);
+        if constexpr (kInline) {
+            cached.store(value ? *value : defaultValue, std::memory_order_release);
+        } else {
+            std::atomic_store_explicit(&cached, std::make_shared<const T>(value ? std::move(*value) : defaultValue),
+                                       std::memory_order_release);
+        }
+    }
+
+    Value get() const {
+        if constexpr (kInline) {
+            return cached.load(std::memory_order_acquire);
+        } else {
+            return std::atomic_load_explicit(&cached, std::memory_order_acquire);
+        }
+    }
+
+    const std::string& name() const override { return key; }
+};
+
+// Pre-resolved, typed accessor for one key: see ConfigurationManager::bind
+template <typename T>
+class ConfigHandle {
+private:
+    std::shared_ptr<BoundSlot<T>> slot;
+
+public:
+    explicit ConfigHandle(std::shared_ptr<BoundSlot<T>> s) : slot(std::move(s)) {}
+
+    // T for int, double and bool; std::shared_ptr<const std::string> for
+    // strings, which stays valid however many reloads follow
+    typename BoundSlot<T>::Value get() const { return slot->get(); }
+    const std::string& key() const { return slot->name(); }
+};
+
+// --- Implementations ---
+
+// Range Validator
+class RangeValidator : public IValidator {
+private:
+    int min, max;
+public:
+    RangeValidator(int minVal, int maxVal) : min(minVal), max(maxVal) {}
+    bool validate(const std::string&, const ConfigValue& value) override {
+        if (std::holds_alternative<int>(value)) {
+            int v = std::get<int>(value);
+            return v >= min && v <= max;
+        }
+        return true; // Pass if type doesn't match (simplification)
+    }
+};
+
+// --- Schema ---
+
+// Declarative rules for config values, compiled once into a CompiledSchema:
+//
+//   ConfigSchema schema;
+//   schema.key("max_connections").type<int>().range(1, 1000);
+//   schema.key("log.level").oneOf({"debug", "info", "warn"});
+//   schema.key("db.host").type<std::string>().pattern("[a-z0-9.-]+");
+//   schema.constraint({"db.pool.min", "db.pool.max"}, minNotAboveMax, "min > max");
+//
+// A rule only sees keys that are present; required() additionally rejects
+// removing a key.
+class ConfigSchema {
+public:
+    // Returns an error message, or nullopt if value passes
+    using Check = std::function<std::optional<std::string>(const ConfigValue& value)>;
+    // Values of a constraint's keys, in order; nullptr for absent keys
+    using CrossCheck = std::function<bool(const std::vector<const ConfigValue*>& values)>;
+
+    struct KeyRules {
+        std::vector<Check> checks;
+        bool required = false;
+
+        template <typename T>
+        KeyRules& type() {
+            static_assert(isConfigType<T>, "T must be one of the ConfigValue types");
+            checks.push_back([](const ConfigValue& v) -> std::optional<std::string> {
+                if (std::holds_alternative<T>(v)) return std::nullopt;
+                return std::string("expected ") + valueTypeName(ConfigValue(T{})) + ", got " + valueTypeName(v);
+            });
+            return *this;
+        }
+
+        // Numeric (int or double) within [min, max]
+        KeyRules& range(double min, double max) {
+            checks.push_back([min, max](const ConfigValue& v) -> std::optional<std::string> {
+                double d;
+                if (const int* i = std::get_if<int>(&v)) {
+                    d = *i;
+                } else if (const double* x = std::get_if<double>(&v)) {
+                    d = *x;
+                } else {
+                    return std::string("expected a number, got ") + valueTypeName(v);
+                }
+                if (d >= min && d <= max) return std::nullopt;
+                std::ostringstream msg;
+                msg << d << " is outside [" << min << ", " << max << "]";
+                return msg.str();
+            });
+            return *this;
+        }
+
+        // String matching the whole of an ECMAScript regex, compiled here once
+        KeyRules& pattern(const std::string& regex) {
+            auto re = std::make_shared<const std::regex>(regex);
+            checks.push_back([re, regex](const ConfigValue& v) -> std::optional<std::string> {
+                const std::string* str = std::get_if<std::string>(&v);
+                if (!str) return std::string("expected string, got ") + valueTypeName(v);
+                if (std::regex_match(*str, *re)) return std::nullopt;
+                return "\"" + *str + "\" does not match " + regex;
+            });
+            return *this;
+        }
+
+        KeyRules& oneOf(std::vector<ConfigValue> allowed) {
+            checks.push_back([allowed = std::move(allowed)](const ConfigValue& v) -> std::optional<std::string> {
+                if (std::find(allowed.begin(), allowed.end(), v) != allowed.end()) return std::nullopt;
+                return std::string("value is not one of the allowed values");
+            });
+            return *this;
+        }
+
+        KeyRules& check(Check fn) {
+            checks.push_back(std::move(fn));
+            return *this;
+        }
+
+        // Adapts a legacy per-key validator
+        KeyRules& validator(std::shared_ptr<IValidator> v, std::string key) {
+            checks.push_back([v = std::move(v), key = std::move(key)](const ConfigValue& value) -> std::optional<std::string> {
+                if (v->validate(key, value)) return std::nullopt;
+                return std::string("rejected by validator");
+            });
+            return *this;
+        }
+
+        KeyRules& require() {
+            required = true;
+            return *this;
+        }
+    };
+
+    struct Constraint {
+        std::vector<std::string> keys;
+        CrossCheck check;
+        std::string message;
+    };
+
+    KeyRules& key(const std::string& name) {
+        auto it = index.find(name);
+        if (it != index.end()) return rules[it->second].second;
+        index.emplace(name, rules.size());
+        rules.emplace_back(name, KeyRules{});
+        return rules.back().second;
+    }
+
+    // Rule over several keys, checked whenever any of them changes
+    void constraint(std::vector<std::string> keys, CrossCheck check, std::string message) {
+        constraints.push_back({std::move(keys), std::move(check), std::move(message)});
+    }
+
+private:
+    friend class CompiledSchema;
+
+    std::vector<std::pair<std::string, KeyRules>> rules; // Stable key ids
+    std::unordered_map<std::string, size_t> index;
+    std::vector<Constraint> constraints;
+};
+
+// A ConfigSchema flattened for validation: each key with rules gets an id,
+// and the id indexes its checks and the constraints that mention it. One
+// hash lookup per changed key, then plain vector walks.
+class CompiledSchema {
+public:
+    // Changed key and its new value (nullptr if the key is removed)
+    using Change = std::pair<std::string, const ConfigValue*>;
+    // Effective value of any key after the change, for constraints
+    using Lookup = std::function<const ConfigValue*(const std::string& key)>;
+
+    static constexpr size_t PARALLEL_MIN_CHANGES = 4096; // Below this, threads cost more than they save
+
+private:
+    struct Compiled {
+        std::vector<ConfigSchema::Check> checks;
+        bool required = false;
+        std::vector<size_t> constraints; // Indices into constraints
+    };
+
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<Compiled> keys;
+    std::vector<ConfigSchema::Constraint> constraints;
+
+    uint32_t idFor(const std::string& key) {
+        auto [it, inserted] = ids.emplace(key, static_cast<uint32_t>(keys.size()));
+        if (inserted) keys.emplace_back();
+        return it->second;
+    }
+
+    // Checks changes[begin, end); appends errors and the constraints touched
+    void checkRange(const std::vector<Change>& changes, size_t begin, size_t end, std::vector<std::string>& errors,
+                    std::vector<size_t>& touched) const {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& [key, value] = changes[i];
+            auto it = ids.find(key);
+            if (it == ids.end()) continue;
+            const Compiled& rules = keys[it->second];
+            touched.insert(touched.end(), rules.constraints.begin(), rules.constraints.end());
+            if (!value) {
+                if (rules.required) errors.push_back(key + ": required key removed");
+                continue;
+            }
+            for (const auto& check : rules.checks) {
+                if (auto error = check(*value)) errors.push_back(key + ": " + *error);
+            }
+        }
+    }
+
+public:
+    CompiledSchema() = default;
+
+    explicit CompiledSchema(const ConfigSchema& schema) : constraints(schema.constraints) {
+        for (const auto& [name, rules] : schema.rules) {
+            Compiled& c = keys[idFor(name)];
+            c.checks = rules.checks;
+            c.required = rules.required;
+        }
+        for (size_t i = 0; i < constraints.size(); ++i) {
+            for (const auto& key : constraints[i].keys) keys[idFor(key)].constraints.push_back(i);
+        }
+    }
+
+    bool empty() const { return keys.empty(); }
+
+    // Every rule broken by changes, as "key: reason" lines; empty if all
+    // pass. Large change sets are checked on several threads.
+    std::vector<std::string> validate(const std::vector<Change>& changes, const Lookup& lookup) const {
+        std::vector<std::string> errors;
+        std::vector<size_t> touched;
+        if (empty()) return errors;
+
+        size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        if (changes.size() < PARALLEL_MIN_CHANGES || threads == 1) {
+            checkRange(changes, 0, changes.size(), errors, touched);
+        } else {
+            size_t chunks = std::min(threads, changes.size() / (PARALLEL_MIN_CHANGES / 4));
+            std::vector<std::future<std::pair<std::vector<std::string>, std::vector<size_t>>>> parts;
+            for (size_t c = 0; c < chunks; ++c) {
+                size_t begin = changes.size() * c / chunks, end = changes.size() * (c + 1) / chunks;
+                parts.push_back(std::async(std::launch::async, [this, &changes, begin, end]() {
+                    std::pair<std::vector<std::string>, std::vector<size_t>> out;
+                    checkRange(changes, begin, end, out.first, out.second);
+                    return out;
+                }));
+            }
+            for (auto& part : parts) { // In order, so errors keep the change order
+                auto [partErrors, partTouched] = part.get();
+                errors.insert(errors.end(), partErrors.begin(), partErrors.end());
+                touched.insert(touched.end(), partTouched.begin(), partTouched.end());
+            }
+        }
+
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        std::vector<const ConfigValue*> values;
+        for (size_t i : touched) {
+            const auto& c = constraints[i];
+            values.clear();
+            for (const auto& key : c.keys) values.push_back(lookup(key));
+            if (!c.check(values)) {
+                std::string keyList;
+                for (const auto& key : c.keys) keyList += (keyList.empty() ? "" : ", ") + key;
+                errors.push_back(keyList + ": " + c.message);
+            }
+        }
+        return errors;
+    }
+};
+
+// Mock Source (Simulates a file or DB)
+class MockSource : public IConfigSource {
+private:
+    std::unordered_map<std::string, ConfigValue> data;
+    ConfigDelta pending; // Changes not yet picked up by the manager
+    std::function<void()> callback;
+public:
+    MockSource() {
+        data["max_connections"] = 100;
+        data["app_name"] = std::string("MyApp");
+        data["debug_mode"] = true;
+    }
+
+    std::unordered_map<std::string, ConfigValue> load() override {
+        pending = {};
+        return data;
+    }
+
+    std::optional<ConfigDelta> loadDelta() override {
+        return std::exchange(pending, {});
+    }
+
+    void watch(std::function<void()> onChangeCallback) override {
+        callback = onChangeCallback;
+    }
+
+    std::string name() const override { return "mock"; }
+
+    // Method to simulate external change
+    void updateData(const std::string& key, ConfigValue value) {
+        data[key] = value;
+        pending.upserts[key] = value;
+        pending.removals.erase(key);
+        if (callback) {
+            std::cout << "[Source] Detected change. Triggering reload...\n";
+            callback();
+        }
+    }
+};
+
+// --- File Source ---
+
+// Read-only memory mapping of a whole file; throws std::runtime_error if the
+// file cannot be opened or mapped
+class MappedFile {
+private:
+    void* addr = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(err));
+        }
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                throw std::runtime_error("Cannot map " + path + ": " + std::strerror(err));
+            }
+        }
+        ::close(fd); // The mapping stays valid without the descriptor
+    }
+
+    ~MappedFile() {
+        if (addr) ::munmap(addr, length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(addr); }
+    size_t size() const { return length; }
+    std::string_view view() const { return {data(), length}; }
+};
+
+namespace detail {
+
+inline std::string_view trim(std::string_view s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string_view::npos) return {};
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+// Drops a trailing "# ..." or "; ..." comment from an unquoted fragment
+inline std::string_view stripComment(std::string_view s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        if ((s[i] == '#' || s[i] == ';') && (i == 0 || s[i - 1] == ' ' || s[i - 1] == '\t')) {
+            return trim(s.substr(0, i));
+        }
+    }
+    return s;
+}
+
+inline std::runtime_error parseError(size_t line, const std::string& what) {
+    return std::runtime_error("line " + std::to_string(line) + ": " + what);
+}
+
+// Types a value by its shape: quoted -> string, true/false -> bool,
+// integer -> int, other numbers -> double, anything else -> bare string
+inline ConfigValue parseScalar(std::string_view raw, size_t line) {
+    if (!raw.empty() && (raw.front() == '"' || raw.front() == '\'')) {
+        char quote = raw.front();
+        std::string out;
+        size_t i = 1;
+        for (;;) {
+            // Copy the run up to the next quote or escape in one go
+            size_t stop = raw.find_first_of(quote == '"' ? std::string_view("\"\\") : std::string_view("'"), i);
+            if (stop == std::string_view::npos) throw parseError(line, "unterminated string");
+            out.append(raw.data() + i, stop - i);
+            i = stop;
+            if (raw[i] == quote) break;
+            if (++i == raw.size()) throw parseError(line, "unterminated string");
+            switch (raw[i++]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            default: out += raw[i - 1]; break; // \" and \\ and anything else
+            }
+        }
+        if (!stripComment(trim(raw.substr(i + 1))).empty()) {
+            throw parseError(line, "unexpected text after string");
+        }
+        return out;
+    }
+
+    std::string_view v = stripComment(raw);
+    if (v == "true") return true;
+    if (v == "false") return false;
+    const char* end = v.data() + v.size();
+    int i = 0;
+    auto [ip, iec] = std::from_chars(v.data(), end, i);
+    if (iec == std::errc() && ip == end && !v.empty()) return i;
+    double d = 0;
+    auto [dp, dec] = std::from_chars(v.data(), end, d);
+    if (dec == std::errc() && dp == end && !v.empty()) return d;
+    return std::string(v);
+}
+
+} // namespace detail
+
+// Parses INI / TOML-style text: "key = value" lines, "[section]" headers that
+// prefix the keys below them ("[db]" + "port" -> "db.port"), and '#' or ';'
+// comments. The text is scanned through string_views; only the final keys
+// and string values are copied. Throws std::runtime_error on a malformed line.
+inline ConfigLayer parseConfigText(std::string_view text) {
+    ConfigLayer out;
+    // One key per line at most; sizing up front avoids rehashing large files
+    size_t lines = 0;
+    for (const char* p = text.data(); (p = static_cast<const char*>(std::memchr(p, '\n', text.data() + text.size() - p)));
+         ++p) {
+        ++lines;
+    }
+    out.reserve(lines + 1);
+    std::string prefix;
+    std::string key;
+    size_t lineNo = 0;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        std::string_view line = detail::trim(text.substr(0, nl));
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+        ++lineNo;
+
+        if (line.empty() || line.front() == '#' || line.front() == ';') continue;
+        if (line.front() == '[') {
+            size_t close = line.find(']');
+            if (close == std::string_view::npos || line.substr(0, 2) == "[[") {
+                throw detail::parseError(lineNo, "bad section header");
+            }
+            std::string_view section = detail::trim(line.substr(1, close - 1));
+            if (!detail::stripComment(detail::trim(line.substr(close + 1))).empty()) {
+                throw detail::parseError(lineNo, "unexpected text after section header");
+            }
+            prefix = section.empty() ? std::string() : std::string(section) + ".";
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos) throw detail::parseError(lineNo, "expected key = value");
+        std::string_view name = detail::trim(line.substr(0, eq));
+        if (name.empty()) throw detail::parseError(lineNo, "empty key");
+        key.assign(prefix).append(name);
+        out.insert_or_assign(key, detail::parseScalar(detail::trim(line.substr(eq + 1)), lineNo));
+    }
+    return out;
+}
+
+// Config file source. load() maps the file and parses it in place. watch()
+// starts a thread that listens for changes to the file (inotify on the
+// directory on Linux, so editors that replace the file by rename are seen;
+// mtime polling elsewhere) and calls back once a burst of events has been
+// quiet for the debounce interval.
+class FileConfigSource : public IConfigSource {
+private:
+    std::string path;
+    std::chrono::milliseconds debounce;
+    std::mutex callbackMutex;
+    std::function<void()> callback;
+    std::thread watcher;
+#ifdef __linux__
+    int stopFd = -1; // eventfd that wakes the watcher for shutdown
+#else
+    std::mutex stopMutex;
+    std::condition_variable stopCv;
+    bool stopping = false;
+#endif
+
+    void fire() {
+        std::function<void()> cb;
+        {
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            cb = callback;
+        }
+        if (!cb) return;
+        std::cout << "[FileSource] Detected change in " << path << ". Triggering reload...\n";
+        try {
+            cb();
+        } catch (const std::exception& e) {
+            // Keep watching; the previous configuration stays published
+            std::cout << "[FileSource] Reload of " << path << " failed: " << e.what() << "\n";
+        }
+    }
+
+#ifdef __linux__
+    void watchLoop() {
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0 || ::inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_ATTRIB) < 0) {
+            std::cout << "[FileSource] Cannot watch " << dir << ": " << std::strerror(errno) << "\n";
+            if (fd >= 0) ::close(fd);
+            return;
+        }
+
+        pollfd fds[2] = {{fd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+        bool dirty = false;
+        for (;;) {
+            int n = ::poll(fds, 2, dirty ? static_cast<int>(debounce.count()) : -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents) break;
+            if (n == 0) { // Quiet for a whole debounce interval
+                dirty = false;
+                fire();
+                continue;
+            }
+            alignas(inotify_event) char buf[4096];
+            ssize_t len;
+            while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len; ) {
+                    auto* ev = reinterpret_cast<inotify_event*>(p);
+                    if (ev->len && name == ev->name) dirty = true;
+                    p += sizeof(inotify_event) + ev->len;
+                }
+            }
+        }
+        ::close(fd);
+    }
+#else
+    void watchLoop() {
+        auto signature = [this]() {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0) return std::pair<long long, long long>(-1, -1);
+            return std::pair<long long, long long>(static_cast<long long>(st.st_mtime), static_cast<long long>(st.st_size));
+        };
+        auto last = signature();
+        bool dirty = false;
+        std::unique_lock<std::mutex> lock(stopMutex);
+        while (!stopCv.wait_for(lock, debounce, [this] { return stopping; })) {
+            auto now = signature();
+            if (now != last) {
+                last = now;
+                dirty = true;
+            } else if (dirty) { // Unchanged for a whole interval
+                dirty = false;
+                lock.unlock();
+                fire();
+                lock.lock();
+            }
+        }
+    }
+#endif
+
+public:
+    explicit FileConfigSource(std::string filePath,
+                              std::chrono::milliseconds debounceInterval = std::chrono::milliseconds(50))
+        : path(std::move(filePath)), debounce(debounceInterval) {}
+
+    ~FileConfigSource() override {
+        if (!watcher.joinable()) return;
+#ifdef __linux__
+        uint64_t one = 1;
+        ssize_t ignored = ::write(stopFd, &one, sizeof(one));
+        (void)ignored;
+        watcher.join();
+        ::close(stopFd);
+#else
+        {
+            std::lock_guard<std::mutex> lock(stopMutex);
+            stopping = true;
+        }
+        stopCv.notify_one();
+        watcher.join();
+#endif
+    }
+
+    std::unordered_map<std::string, ConfigValue> load() override {
+        MappedFile file(path);
+        try {
+            return parseConfigText(file.view());
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ", " + e.what());
+        }
+    }
+
+    void watch(std::function<void()> onChangeCallback) override {
+        {
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            callback = std::move(onChangeCallback);
+        }
+        if (watcher.joinable()) return;
+#ifdef __linux__
+        stopFd = ::eventfd(0, EFD_CLOEXEC);
+        if (stopFd < 0) throw std::runtime_error(std::string("eventfd: ") + std::strerror(errno));
+#endif
+        watcher = std::thread(&FileConfigSource::watchLoop, this);
+    }
+
+    std::string name() const override { return "file " + path; }
+};
+
+extern char** environ; // POSIX, but not declared by every libc's headers
+
+// Environment variables under a prefix, e.g. with prefix "APP_":
+// APP_MAX_CONNECTIONS -> max_connections, APP_DB__POOL__MAX -> db.pool.max
+// (names are lowercased and "__" separates key segments). Values are typed
+// like file values, so APP_DEBUG_MODE=true is a bool. Read once per load.
+class EnvConfigSource : public IConfigSource {
+private:
+    std::string prefix;
+
+public:
+    explicit EnvConfigSource(std::string varPrefix) : prefix(std::move(varPrefix)) {}
+
+    std::unordered_map<std::string, ConfigValue> load() override {
+        std::unordered_map<std::string, ConfigValue> out;
+        for (char** env = environ; env && *env; ++env) {
+            std::string_view var(*env);
+            size_t eq = var.find('=');
+            if (eq == std::string_view::npos || var.substr(0, prefix.size()) != prefix || eq <= prefix.size()) continue;
+            std::string key;
+            for (size_t i = prefix.size(); i < eq; ++i) {
+                if (var[i] == '_' && i + 1 < eq && var[i + 1] == '_') {
+                    key += '.';
+                    ++i;
+                } else {
+                    key += static_cast<char>(std::tolower(static_cast<unsigned char>(var[i])));
+                }
+            }
+            try {
+                out.insert_or_assign(std::move(key), detail::parseScalar(detail::trim(var.substr(eq + 1)), 1));
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error("Environment variable " + std::string(var.substr(0, eq)) + ": " + e.what());
+            }
+        }
+        return out;
+    }
+
+    void watch(std::function<void()>) override {} // The environment does not change under us
+
+    std::string name() const override { return "env " + prefix + "*"; }
+};
+
+// --- Binary Snapshot ---
+
+// Binary snapshot file mapped into memory and served in place: opening it
+// reads only the header, and getValue reads straight from the mapping
+class MappedSnapshot {
+private:
+    MappedFile file;
+    FlatConfigTable table;
+
+public:
+    explicit MappedSnapshot(const std::string& path) : file(path), table(file.data(), file.size()) {}
+
+    const FlatConfigTable& flat() const { return table; }
+    size_t size() const { return table.size(); }
+    uint64_t version() const { return table.version(); }
+
+    template <typename T>
+    T getValue(std::string_view key, T defaultValue) const {
+        auto value = table.get<T>(key);
+        return value ? std::move(*value) : defaultValue;
+    }
+
+    // String value without a copy; valid as long as the snapshot is open
+    std::string_view getString(std::string_view key, std::string_view defaultValue = {}) const {
+        const FlatConfigTable::Entry* e = table.find(key);
+        auto value = e ? table.stringOf(*e) : std::nullopt;
+        return value ? *value : defaultValue;
+    }
+};
+
+// Source that loads a binary snapshot written by exportSnapshot, e.g. as
+// the lowest layer at startup before the text files are parsed
+class SnapshotFileSource : public IConfigSource {
+private:
+    std::string path;
+
+public:
+    explicit SnapshotFileSource(std::string snapshotPath) : path(std::move(snapshotPath)) {}
+
+    std::unordered_map<std::string, ConfigValue> load() override {
+        return MappedSnapshot(path).flat().toLayer();
+    }
+
+    void watch(std::function<void()>) override {} // Snapshots are immutable files
+
+    std::string name() const override { return "snapshot " + path; }
+};
+
+// Pending notification for one observer. Reloads merge into it while it
+// waits for the notification thread, so a slow observer gets one callback
+// with the latest version instead of a backlog.
+struct ObserverMailbox {
+    std::weak_ptr<IConfigObserver> observer;
+    std::mutex mutex; // Guards pending and queued
+    ConfigUpdate pending;
+    bool queued = false;
+
+    explicit ObserverMailbox(std::weak_ptr<IConfigObserver> obs) : observer(std::move(obs)) {}
+
+    // Merges keys in; returns true if the mailbox needs to be queued
+    bool post(uint64_t version, const std::vector<std::string>& keys) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.version = std::max(pending.version, version);
+        std::vector<std::string> merged;
+        merged.reserve(pending.keys.size() + keys.size());
+        std::set_union(pending.keys.begin(), pending.keys.end(), keys.begin(), keys.end(), std::back_inserter(merged));
+        pending.keys = std::move(merged);
+        return !std::exchange(queued, true);
+    }
+
+    ConfigUpdate take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued = false;
+        return std::exchange(pending, {});
+    }
+};
+
+// Mailboxes indexed by dotted key segments: "db.pool.max" is the path
+// db -> pool -> max. A changed key is matched by walking its own path,
+// picking up subtree subscriptions on the way and exact ones at the end,
+// so the cost depends on the key's depth rather than on how many
+// observers are registered. Immutable: add() returns a new trie that
+// copies only the nodes on the pattern's path and shares the rest.
+class SubscriptionTrie {
+private:
+    using Mailboxes = std::vector<std::shared_ptr<ObserverMailbox>>;
+
+    struct Node {
+        std::map<std::string, std::shared_ptr<const Node>, std::less<>> children;
+        Mailboxes exact;   // The key itself
+        Mailboxes subtree; // Every key below
+    };
+
+    std::shared_ptr<const Node> root = std::make_shared<const Node>();
+
+    // Appends mailboxes of live observers, each once
+    static void take(const Mailboxes& list, Mailboxes& out) {
+        for (const auto& box : list) {
+            if (!box->observer.expired() && std::find(out.begin(), out.end(), box) == out.end()) out.push_back(box);
+        }
+    }
+
+    // Copy of list without mailboxes whose observer is gone, plus box
+    static Mailboxes withAdded(const Mailboxes& list, std::shared_ptr<ObserverMailbox> box) {
+        Mailboxes out;
+        for (const auto& b : list) {
+            if (!b->observer.expired()) out.push_back(b);
+        }
+        out.push_back(std::move(box));
+        return out;
+    }
+
+    static std::shared_ptr<const Node> addAt(const Node& node, std::string_view path, bool isSubtree,
+                                             std::shared_ptr<ObserverMailbox> box) {
+        auto copy = std::make_shared<Node>(node);
+        if (path.empty()) {
+            Mailboxes& list = isSubtree ? copy->subtree : copy->exact;
+            list = withAdded(list, std::move(box));
+            return copy;
+        }
+        size_t dot = path.find('.');
+        std::string_view segment = path.substr(0, dot);
+        std::string_view rest = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+        auto it = copy->children.find(segment);
+        const Node& child = it != copy->children.end() ? *it->second : Node{};
+        copy->children[std::string(segment)] = addAt(child, rest, isSubtree, std::move(box));
+        return copy;
+    }
+
+public:
+    // pattern is "a.b" (that key), "a.b.*" (every key under a.b) or "*".
+    // Throws std::invalid_argument for any other use of '*'.
+    SubscriptionTrie add(std::string_view pattern, std::shared_ptr<ObserverMailbox> box) const {
+        bool isSubtree = pattern == "*" || (pattern.size() > 2 && pattern.substr(pattern.size() - 2) == ".*");
+        std::string_view path = pattern == "*" ? std::string_view() : isSubtree ? pattern.substr(0, pattern.size() - 2) : pattern;
+        if (path.find('*') != std::string_view::npos || (!isSubtree && path.empty())) {
+            throw std::invalid_argument("Bad subscription pattern: " + std::string(pattern));
+        }
+        SubscriptionTrie next;
+        next.root = addAt(*root, path, isSubtree, std::move(box));
+        return next;
+    }
+
+    // Mailboxes of live observers subscribed to key, each once
+    void collect(std::string_view key, Mailboxes& out) const {
+        const Node* node = root.get();
+        take(node->subtree, out);
+        while (!key.empty()) {
+            size_t dot = key.find('.');
+            auto it = node->children.find(key.substr(0, dot));
+            if (it == node->children.end()) return;
+            node = it->second.get();
+            key = dot == std::string_view::npos ? std::string_view() : key.substr(dot + 1);
+            if (!key.empty()) take(node->subtree, out); // "db.*" does not match "db" itself
+        }
+        take(node->exact, out);
+    }
+};
+
+// Published subscription state, replaced wholesale on every subscribe
+struct SubscriptionSet {
+    SubscriptionTrie trie;
+    // One mailbox per observer, however many patterns it subscribed to
+    std::map<const IConfigObserver*, std::shared_ptr<ObserverMailbox>> mailboxes;
+};
+
+// One published version, as recorded in the audit log
+struct ConfigAuditEntry {
+    uint64_t version = 0;
+    std::chrono::system_clock::time_point publishedAt{};
+    std::string action; // "add sources", "reload", "source change" or "rollback to vN"
+    std::vector<std::string> sources; // Names of the sources read; empty for a rollback
+    std::vector<std::string> keys; // Keys whose effective value changed, sorted
+};
+
+// Consistent, versioned view of one published snapshot. Every read through
+// it sees the same version, however many reloads happen meanwhile; it
+// keeps that snapshot alive for as long as it exists. Cheap to copy.
+class ConfigView {
+private:
+    std::shared_ptr<const ConfigSnapshot> snap;
+
+public:
+    explicit ConfigView(std::shared_ptr<const ConfigSnapshot> snapshot) : snap(std::move(snapshot)) {}
+
+    uint64_t version() const { return snap->version; }
+    std::chrono::system_clock::time_point loadedAt() const { return snap->loadedAt; }
+
+    template <typename T>
+    T getValue(const std::string& key, T defaultValue) const {
+        std::optional<T> value = snap->get<T>(key);
+        return value ? std::move(*value) : defaultValue;
+    }
+
+    bool contains(const std::string& key) const {
+        const FlatConfigTable* table = nullptr;
+        return snap->find(key, table) != nullptr;
+    }
+
+    ConfigLayer getSection(const std::string& section) const {
+        return snap->withPrefix(section.empty() ? std::string() : section + ".");
+    }
+};
+
+// Configuration Manager
+class ConfigurationManager {
+private:
+    struct RegisteredSource {
+        std::shared_ptr<IConfigSource> source;
+        Precedence level;
+        // Set when a rollback replaced the source's layer or a reload of it
+        // failed validation: its layer no longer matches the source, so its
+        // next change is a full load() and diff instead of a delta
+        std::shared_ptr<std::atomic<bool>> resync = std::make_shared<std::atomic<bool>>(false);
+        // Held from reading the source until what was read is published, so
+        // reads of one source are published in the order they were made and
+        // an older read never overwrites a newer one. Other sources and
+        // readers are not blocked.
+        std::shared_ptr<std::mutex> readMutex = std::make_shared<std::mutex>();
+    };
+
+    // New contents of one source: either everything it returned from
+    // load() or the delta it reported
+    struct LayerUpdate {
+        size_t index;
+        std::optional<ConfigLayer> full;
+        ConfigDelta delta;
+    };
+
+    // Current snapshot; only accessed through the std::atomic_* free functions
+    std::shared_ptr<const ConfigSnapshot> current = std::make_shared<const ConfigSnapshot>();
+    // Highest version published so far, stored after the pointer. Readers
+    // compare it with the version of their thread-local copy, so the
+    // shared_ptr (and its reference count) is only touched once per reload
+    // per thread.
+    std::atomic<uint64_t> publishedVersion{0};
+    // Recent versions for the audit log and rollback, oldest first. Their
+    // snapshots share unchanged level tables and layer nodes with each
+    // other, so each costs roughly what its reload changed.
+    struct Revision {
+        std::shared_ptr<const ConfigSnapshot> snapshot;
+        ConfigAuditEntry audit;
+    };
+    mutable std::mutex historyMutex; // Guards history and historyLimit
+    std::deque<Revision> history;
+    size_t historyLimit = 16;
+    std::mutex sourcesMutex; // Guards sources; held only to append or copy
+    std::vector<RegisteredSource> sources; // Index is the source's layer index
+    std::mutex schemaMutex; // Serialises schema writers
+    ConfigSchema schemaRules; // Guarded by schemaMutex; compiled into schema
+    std::shared_ptr<const CompiledSchema> schema = std::make_shared<const CompiledSchema>();
+    // Copy-on-write: notifying reads it with one atomic load, subscribe
+    // publishes a modified copy. observersMutex only serialises writers.
+    std::shared_ptr<const SubscriptionSet> subscriptions = std::make_shared<const SubscriptionSet>();
+    std::mutex observersMutex;
+    // Mailboxes with a pending update, drained by the notification thread
+    WaitableQueue<UnboundedMPMCQueue<std::shared_ptr<ObserverMailbox>>> notifications;
+    std::mutex idleMutex; // Guards undelivered
+    std::condition_variable idleCv;
+    size_t undelivered = 0; // Mailboxes queued or being delivered
+    std::thread notifier;
+    // Held after a publish while bound slots are refreshed; never held
+    // during source I/O or validation
+    std::mutex publishMutex;
+    std::vector<std::weak_ptr<IBoundSlot>> boundSlots; // Guarded by publishMutex
+
+    ConfigurationManager() : notifier(&ConfigurationManager::deliverNotifications, this) {}
+
+    ~ConfigurationManager() {
+        notifications.close(); // Queued updates are still delivered first
+        notifier.join();
+    }
+
+    // Notification thread: one callback per queued mailbox, carrying
+    // everything merged into it since it was queued
+    void deliverNotifications() {
+        std::shared_ptr<ObserverMailbox> box;
+        while (notifications.wait_dequeue(box)) {
+            ConfigUpdate update = box->take();
+            if (auto obs = box->observer.lock()) {
+                try {
+                    obs->onConfigChanged(update);
+                } catch (const std::exception& e) {
+                    std::cout << "[Manager] Observer failed on version " << update.version << ": " << e.what() << "\n";
+                }
+            }
+            box.reset();
+            std::lock_guard<std::mutex> lock(idleMutex);
+            if (--undelivered == 0) idleCv.notify_all();
+        }
+    }
+
+    struct SnapshotHolder {
+        std::shared_ptr<const ConfigSnapshot> snapshot;
+    };
+
+    // Snapshot as seen by the calling thread, held through a holder owned
+    // by that thread. Each thread keeps the last snapshot it read alive
+    // until it reads again after the next reload. The cache is per thread,
+    // not per instance, which is fine for a singleton.
+    const std::shared_ptr<const SnapshotHolder>& localHolder() const {
+        thread_local std::shared_ptr<const SnapshotHolder> holder;
+        if (!holder || holder->snapshot->version != publishedVersion.load(std::memory_order_acquire)) {
+            holder = std::make_shared<const SnapshotHolder>(
+                SnapshotHolder{std::atomic_load_explicit(&current, std::memory_order_acquire)});
+        }
+        return holder;
+    }
+
+    const ConfigSnapshot& localSnapshot() const { return *localHolder()->snapshot; }
+
+    // Posts the changed keys to every matching observer's mailbox and
+    // queues the mailboxes that were idle; never calls an observer itself
+    void notifyObservers(uint64_t version, const std::vector<std::string>& changedKeys) {
+        auto subs = std::atomic_load(&subscriptions);
+        std::map<std::shared_ptr<ObserverMailbox>, std::vector<std::string>> perObserver;
+        std::vector<std::shared_ptr<ObserverMailbox>> matched;
+        for (const auto& key : changedKeys) { // Sorted, so each list stays sorted
+            matched.clear();
+            subs->trie.collect(key, matched);
+            for (auto& box : matched) perObserver[box].push_back(key);
+        }
+        std::cout << "[Manager] Notifying " << perObserver.size() << " observer(s) of " << changedKeys.size()
+                  << " changed key(s).\n";
+        for (const auto& [box, keys] : perObserver) {
+            if (!box->post(version, keys)) continue; // Already queued; merged in
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                ++undelivered;
+            }
+            notifications.enqueue(box);
+        }
+    }
+
+    // Refreshes the slots of changed keys and drops slots whose handles are
+    // gone. Slots are read from the latest snapshot rather than the one this
+    // caller published: if two reloads race, whichever refreshes last still
+    // leaves every slot at the newest value.
+    void refreshBoundSlots(const std::unordered_set<std::string>& changed) {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        auto latest = std::atomic_load(&current);
+        for (auto it = boundSlots.begin(); it != boundSlots.end(); ) {
+            if (auto slot = it->lock()) {
+                if (changed.count(slot->name())) slot->refresh(*latest);
+                ++it;
+            } else {
+                it = boundSlots.erase(it);
+            }
+        }
+    }
+
+    // Delta that turns a layer into the freshly loaded data
+    static ConfigDelta diffLayer(const PersistentLayer& layer, const ConfigLayer& data) {
+        ConfigDelta delta;
+        layer.forEach([&](const std::string& key, const ConfigValue& value) {
+            auto it = data.find(key);
+            if (it == data.end()) {
+                delta.removals.insert(key);
+            } else if (!(it->second == value)) {
+                delta.upserts.emplace(key, it->second);
+            }
+        });
+        for (const auto& [key, value] : data) {
+            if (!layer.find(key)) delta.upserts.emplace(key, value);
+        }
+        return delta;
+    }
+
+    static PersistentLayer applyDelta(PersistentLayer layer, const ConfigDelta& delta) {
+        for (const auto& key : delta.removals) layer = layer.erase(key);
+        for (const auto& [key, value] : delta.upserts) layer = layer.set(key, value);
+        return layer;
+    }
+
+    std::vector<RegisteredSource> knownSources() {
+        std::lock_guard<std::mutex> lock(sourcesMutex);
+        return sources;
+    }
+
+    // Source indices from highest to lowest precedence
+    static std::vector<size_t> precedenceOrder(const std::vector<RegisteredSource>& known) {
+        std::vector<size_t> order(known.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return known[a].level != known[b].level ? known[a].level > known[b].level : a > b;
+        });
+        return order;
+    }
+
+    // Effective value of key across layers; nullptr if no layer defines it
+    static const ConfigValue* resolve(const std::string& key,
+                                      const std::vector<PersistentLayer>& layers,
+                                      const std::vector<size_t>& order) {
+        for (size_t i : order) {
+            if (i >= layers.size()) continue;
+            if (const ConfigValue* value = layers[i].find(key)) return value;
+        }
+        return nullptr;
+    }
+
+    // Merges the sources of one level (later sources win) into a new table
+    static std::shared_ptr<const LevelTable> buildLevel(Precedence level, const std::vector<RegisteredSource>& known,
+                                                        const std::vector<PersistentLayer>& layers,
+                                                        uint64_t version) {
+        ConfigLayer merged;
+        for (size_t i = 0; i < known.size() && i < layers.size(); ++i) {
+            if (known[i].level != level) continue;
+            layers[i].forEach([&](const std::string& key, const ConfigValue& value) { merged.insert_or_assign(key, value); });
+        }
+        return std::make_shared<const LevelTable>(merged, version);
+    }
+
+    // Overlays of up to OVERLAY_MIN keys, or up to 1/OVERLAY_FRACTION of
+    // their base, are kept; a larger one is compacted into a new base. So a
+    // base of n keys is rebuilt at most once per n/OVERLAY_FRACTION changes.
+    static constexpr size_t OVERLAY_MIN = 64;
+    static constexpr size_t OVERLAY_FRACTION = 8;
+
+    // Value of key at one level (later sources win), or nullptr
+    static const ConfigValue* levelValue(Precedence level, const std::string& key,
+                                         const std::vector<RegisteredSource>& known,
+                                         const std::vector<PersistentLayer>& layers) {
+        for (size_t i = std::min(known.size(), layers.size()); i-- > 0; ) {
+            if (known[i].level != level) continue;
+            if (const ConfigValue* value = layers[i].find(key)) return value;
+        }
+        return nullptr;
+    }
+
+    // A level after its sources changed keys: the old overlay with those
+    // keys re-resolved against the base, costing the size of the overlay
+    // rather than of the level. Compacts into a new base past the limit.
+    static Level updateLevel(const Level& old, Precedence level, const std::unordered_set<std::string>& keys,
+                             const std::vector<RegisteredSource>& known, const std::vector<PersistentLayer>& layers,
+                             uint64_t version) {
+        const FlatConfigTable& base = old.base->flat;
+        const FlatConfigTable& overlay = old.overlay->flat;
+        ConfigLayer upserts;
+        std::unordered_set<std::string> removed;
+        for (size_t rank = 0; rank < overlay.size(); ++rank) {
+            const FlatConfigTable::Entry& e = overlay.sorted(rank);
+            if (overlay.removed(e)) {
+                removed.emplace(overlay.keyOf(e));
+            } else {
+                upserts.emplace(std::string(overlay.keyOf(e)), overlay.valueOf(e));
+            }
+        }
+        for (const auto& key : keys) {
+            upserts.erase(key);
+            removed.erase(key);
+            const ConfigValue* value = levelValue(level, key, known, layers);
+            const FlatConfigTable::Entry* e = base.size() != 0 ? base.find(key) : nullptr;
+            if (value && e && *value == base.valueOf(*e)) continue; // Back to the base value
+            if (value) {
+                upserts.emplace(key, *value);
+            } else if (e) {
+                removed.insert(key);
+            }
+        }
+
+        if (upserts.size() + removed.size() > std::max(OVERLAY_MIN, base.size() / OVERLAY_FRACTION)) {
+            return Level{buildLevel(level, known, layers, version), LevelTable::empty()};
+        }
+        if (upserts.empty() && removed.empty()) return Level{old.base, LevelTable::empty()};
+        return Level{old.base, std::make_shared<const LevelTable>(
+                                   upserts, version, std::vector<std::string>(removed.begin(), removed.end()))};
+    }
+
+    // Builds, validates and publishes a snapshot with the given layers
+    // replaced, without taking any lock. The new snapshot is swapped in with
+    // a compare-exchange against the one it was built from; if another
+    // reload published first, the updates are re-applied on top of that one.
+    // Callers hold the read mutex of every updated source, so that winner
+    // never holds a newer read of the same source.
+    // Only keys whose effective value changes are validated and notified.
+    // action says what triggered the reload, for the audit log.
+    void publish(std::vector<LayerUpdate> updates, const std::string& action) {
+        std::shared_ptr<const ConfigSnapshot> base = std::atomic_load(&current);
+        std::shared_ptr<const ConfigSnapshot> published;
+        std::vector<std::string> changedKeys;
+        std::vector<std::string> sourceNames;
+        for (;;) {
+            // Read after base, so every source with a layer in base is known
+            std::vector<RegisteredSource> known = knownSources();
+            std::vector<size_t> order = precedenceOrder(known);
+            auto layers = base->layers;
+            std::array<std::unordered_set<std::string>, PRECEDENCE_LEVELS> levelKeys; // Changed keys per level
+            std::unordered_set<std::string> candidates;
+            for (auto& update : updates) {
+                if (layers.size() <= update.index) layers.resize(update.index + 1);
+                PersistentLayer& layer = layers[update.index];
+                ConfigDelta diffed;
+                if (update.full) diffed = diffLayer(layer, *update.full);
+                const ConfigDelta& delta = update.full ? diffed : update.delta;
+                if (delta.empty()) continue;
+                auto& touched = levelKeys[static_cast<size_t>(known[update.index].level)];
+                for (const auto& [key, value] : delta.upserts) touched.insert(key);
+                touched.insert(delta.removals.begin(), delta.removals.end());
+                candidates.insert(touched.begin(), touched.end());
+                layer = applyDelta(std::move(layer), delta);
+            }
+
+            if (candidates.empty()) {
+                std::cout << "[Manager] Reload made no effective change.\n";
+                return;
+            }
+
+            std::vector<std::pair<std::string, const ConfigValue*>> changes; // null = removed
+            for (const auto& key : candidates) {
+                const ConfigValue* value = resolve(key, layers, order);
+                std::optional<ConfigValue> old = base->value(key);
+                if (!value && !old) continue;
+                if (value && old && *value == *old) continue;
+                changes.emplace_back(key, value);
+            }
+
+            // Validation: every failure is reported, then the reload is aborted.
+            // The sources have already handed over what was read (a delta is
+            // consumed by loadDelta()), so their layers no longer match them;
+            // their next change is re-read in full, as after a rollback.
+            std::vector<std::string> errors = std::atomic_load(&schema)->validate(
+                changes, [&](const std::string& key) { return resolve(key, layers, order); });
+            if (!errors.empty()) {
+                std::cout << "[Manager] Validation failed (" << errors.size() << " error(s)). Keeping old values.\n";
+                for (const auto& error : errors) std::cout << "  - " << error << "\n";
+                for (const auto& update : updates) known[update.index].resync->store(true);
+                return;
+            }
+
+            // Update only the levels whose sources changed
+            auto next = std::make_shared<ConfigSnapshot>();
+            next->version = base->version + 1;
+            next->loadedAt = std::chrono::system_clock::now();
+            for (size_t level = 0; level < PRECEDENCE_LEVELS; ++level) {
+                next->levels[level] = levelKeys[level].empty()
+                                          ? base->levels[level]
+                                          : updateLevel(base->levels[level], static_cast<Precedence>(level),
+                                                        levelKeys[level], known, layers, next->version);
+            }
+            next->layers = std::move(layers);
+
+            std::shared_ptr<const ConfigSnapshot> candidate = std::move(next);
+            if (std::atomic_compare_exchange_strong(&current, &base, candidate)) {
+                published = std::move(candidate);
+                for (const auto& change : changes) changedKeys.push_back(change.first);
+                for (const auto& update : updates) sourceNames.push_back(known[update.index].source->name());
+                break;
+            }
+            // Lost the race; base now holds the winner, so rebuild on top of it
+        }
+
+        if (changedKeys.empty()) {
+            std::cout << "[Manager] Reload made no effective change.\n";
+        } else {
+            std::cout << "[Manager] Configuration reloaded successfully (" << changedKeys.size() << " key(s) changed).\n";
+        }
+        finishPublish(published, std::move(changedKeys), action, std::move(sourceNames));
+    }
+
+    // Keys whose effective value differs between two snapshots. Only layer
+    // nodes the snapshots do not share are visited.
+    static std::vector<std::string> changedBetween(const ConfigSnapshot& from, const ConfigSnapshot& to) {
+        std::unordered_set<std::string> candidates;
+        static const PersistentLayer empty;
+        for (size_t i = 0; i < std::max(from.layers.size(), to.layers.size()); ++i) {
+            PersistentLayer::forEachDifference(i < from.layers.size() ? from.layers[i] : empty,
+                                               i < to.layers.size() ? to.layers[i] : empty,
+                                               [&](const std::string& key) { candidates.insert(key); });
+        }
+        std::vector<std::string> changed;
+        for (const auto& key : candidates) {
+            if (from.value(key) != to.value(key)) changed.push_back(key);
+        }
+        return changed;
+    }
+
+    // Everything after a successful swap: advances publishedVersion, records
+    // the version in the history, then refreshes bound slots and notifies
+    void finishPublish(const std::shared_ptr<const ConfigSnapshot>& published, std::vector<std::string> changedKeys,
+                       const std::string& action, std::vector<std::string> sourceNames) {
+        // Versions grow by one per swap, so the newest publisher stores the
+        // highest; never let a slower one move the counter backwards
+        uint64_t seen = publishedVersion.load(std::memory_order_relaxed);
+        while (seen < published->version &&
+               !publishedVersion.compare_exchange_weak(seen, published->version, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {
+        }
+
+        std::sort(changedKeys.begin(), changedKeys.end());
+        {
+            // Concurrent publishers may get here out of order
+            std::lock_guard<std::mutex> lock(historyMutex);
+            auto pos = std::find_if(history.begin(), history.end(), [&](const Revision& r) {
+                return r.snapshot->version > published->version;
+            });
+            history.insert(pos, Revision{published, {published->version, published->loadedAt, action,
+                                                     std::move(sourceNames), changedKeys}});
+            while (history.size() > historyLimit) history.pop_front();
+        }
+
+        if (changedKeys.empty()) return;
+        refreshBoundSlots(std::unordered_set<std::string>(changedKeys.begin(), changedKeys.end()));
+        notifyObservers(published->version, changedKeys);
+    }
+
+    // Loads the given sources in full, each on its own thread, so the
+    // slowest source sets the pace rather than the sum of all of them. Then
+    // publishes them together. If any load throws, nothing is published
+    // and the first exception is rethrown once every load has finished.
+    // indices must be ascending: the sources' read mutexes are taken in
+    // that order.
+    void loadAll(const std::vector<RegisteredSource>& known, const std::vector<size_t>& indices, const std::string& action) {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (size_t i : indices) locks.emplace_back(*known[i].readMutex);
+        std::vector<std::future<LayerUpdate>> loads;
+        for (size_t i : indices) {
+            known[i].resync->store(false);
+            loads.push_back(std::async(std::launch::async, [source = known[i].source, i]() {
+                return LayerUpdate{i, source->load(), {}};
+            }));
+        }
+        std::vector<LayerUpdate> updates;
+        std::exception_ptr error;
+        for (auto& load : loads) {
+            try {
+                updates.push_back(load.get());
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+        publish(std::move(updates), action);
+    }
+
+    // Re-reads one source: its delta if it reports one, else load() + diff.
+    // Only this source's read mutex is held while it is read, however slow
+    // it is.
+    void reloadSource(IConfigSource* source) {
+        std::vector<RegisteredSource> known = knownSources();
+        for (size_t i = 0; i < known.size(); ++i) {
+            if (known[i].source.get() != source) continue;
+            std::lock_guard<std::mutex> lock(*known[i].readMutex);
+            LayerUpdate update{i, std::nullopt, {}};
+            std::optional<ConfigDelta> delta;
+            if (known[i].resync->exchange(false)) {
+                source->loadDelta(); // Superseded by the full load
+            } else {
+                delta = source->loadDelta();
+            }
+            if (delta) {
+                update.delta = std::move(*delta);
+            } else {
+                update.full = source->load();
+            }
+            publish({std::move(update)}, "source change");
+            return;
+        }
+    }
+
+public:
+    static ConfigurationManager& getInstance() {
+        static ConfigurationManager instance;
+        return instance;
+    }
+
+    ConfigurationManager(const ConfigurationManager&) = delete;
+    ConfigurationManager& operator=(const ConfigurationManager&) = delete;
+
+    void addSource(std::shared_ptr<IConfigSource> source, Precedence level = Precedence::File) {
+        addSources({{std::move(source), level}});
+    }
+
+    // Registers several sources and loads them concurrently; the first
+    // snapshot that includes them has all of them
+    void addSources(std::vector<std::pair<std::shared_ptr<IConfigSource>, Precedence>> added) {
+        std::vector<size_t> indices;
+        {
+            std::lock_guard<std::mutex> lock(sourcesMutex);
+            for (auto& [source, level] : added) {
+                indices.push_back(sources.size());
+                sources.push_back({source, level});
+            }
+        }
+        for (auto& [source, level] : added) {
+            IConfigSource* raw = source.get();
+            source->watch([this, raw]() {
+                this->reloadSource(raw);
+            });
+        }
+        loadAll(knownSources(), indices, "add sources");
+    }
+
+    // Adds validator to key's rules; kept for callers predating setSchema
+    void addValidator(const std::string& key, std::shared_ptr<IValidator> validator) {
+        std::lock_guard<std::mutex> lock(schemaMutex);
+        schemaRules.key(key).validator(std::move(validator), key);
+        std::atomic_store(&schema, std::make_shared<const CompiledSchema>(schemaRules));
+    }
+
+    // Replaces all validation rules, including those from addValidator.
+    // Applies to later reloads; values already published are not rechecked.
+    void setSchema(ConfigSchema rules) {
+        std::lock_guard<std::mutex> lock(schemaMutex);
+        schemaRules = std::move(rules);
+        std::atomic_store(&schema, std::make_shared<const CompiledSchema>(schemaRules));
+    }
+
+    // Observer for every key
+    void registerObserver(std::shared_ptr<IConfigObserver> observer) {
+        subscribe("*", std::move(observer));
+    }
+
+    // Observer for one key ("db.host"), a subtree ("db.*") or everything
+    // ("*"); it is called once per changed key it matches. Throws
+    // std::invalid_argument for any other use of '*'.
+    void subscribe(const std::string& pattern, std::shared_ptr<IConfigObserver> observer) {
+        std::lock_guard<std::mutex> lock(observersMutex);
+        auto next = std::make_shared<SubscriptionSet>(*std::atomic_load(&subscriptions));
+        for (auto it = next->mailboxes.begin(); it != next->mailboxes.end(); ) {
+            it = it->second->observer.expired() ? next->mailboxes.erase(it) : std::next(it);
+        }
+        auto& box = next->mailboxes[observer.get()];
+        if (!box) box = std::make_shared<ObserverMailbox>(observer);
+        next->trie = next->trie.add(pattern, box);
+        std::atomic_store(&subscriptions, std::shared_ptr<const SubscriptionSet>(std::move(next)));
+    }
+
+    // Blocks until every notification posted so far has been delivered
+    void waitForObservers() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idleCv.wait(lock, [this] { return undelivered == 0; });
+    }
+
+    // Every key under section ("db.pool" -> "db.pool.max", ...), keyed by
+    // the rest of the key ("max"), from one consistent snapshot. A range
+    // scan of the snapshot's sorted key order, not a scan of every key.
+    ConfigLayer getSection(const std::string& section) const {
+        return localSnapshot().withPrefix(section.empty() ? std::string() : section + ".");
+    }
+
+    // Full reload: re-reads every source concurrently and diffs each
+    // against its layer. Readers keep using the previous snapshot until the
+    // final swap.
+    void reload() {
+        std::vector<RegisteredSource> known = knownSources();
+        std::vector<size_t> indices(known.size());
+        for (size_t i = 0; i < indices.size(); ++i) indices[i] = i;
+        loadAll(known, indices, "reload");
+    }
+
+    // Makes the configuration of an earlier version current again without
+    // reading any source: it is republished as a new version that reuses
+    // that version's level tables and layers. Observers and bound handles
+    // are told about the keys that differ. The sources still hold their
+    // newer state, so every source whose layer was rolled back is marked:
+    // its next change is re-read in full (load() and diff, even for delta
+    // sources), which brings back whatever it then holds. reload() resyncs
+    // all sources at once. Returns the new version; throws
+    // std::invalid_argument if version is no longer in the history.
+    uint64_t rollback(uint64_t version) {
+        std::shared_ptr<const ConfigSnapshot> target;
+        {
+            std::lock_guard<std::mutex> lock(historyMutex);
+            for (const auto& revision : history) {
+                if (revision.snapshot->version == version) target = revision.snapshot;
+            }
+        }
+        if (!target) {
+            throw std::invalid_argument("Config version " + std::to_string(version) + " is not in the history");
+        }
+
+        std::shared_ptr<const ConfigSnapshot> base = std::atomic_load(&current);
+        std::shared_ptr<const ConfigSnapshot> published;
+        std::vector<std::string> changedKeys;
+        for (;;) {
+            auto next = std::make_shared<ConfigSnapshot>();
+            next->levels = target->levels;
+            next->layers = target->layers;
+            next->version = base->version + 1;
+            next->loadedAt = std::chrono::system_clock::now();
+            changedKeys = changedBetween(*base, *next);
+            std::shared_ptr<const ConfigSnapshot> candidate = std::move(next);
+            if (std::atomic_compare_exchange_strong(&current, &base, candidate)) {
+                published = std::move(candidate);
+                break;
+            }
+        }
+        // Marked after the swap, so a change that lands in between is still
+        // followed by a full load
+        std::vector<RegisteredSource> known = knownSources();
+        static const PersistentLayer empty;
+        for (size_t i = 0; i < known.size(); ++i) {
+            const PersistentLayer& before = i < base->layers.size() ? base->layers[i] : empty;
+            const PersistentLayer& after = i < target->layers.size() ? target->layers[i] : empty;
+            if (!before.sameAs(after)) known[i].resync->store(true);
+        }
+        std::cout << "[Manager] Rolled back to v" << version << " as v" << published->version << " ("
+                  << changedKeys.size() << " key(s) changed).\n";
+        finishPublish(published, std::move(changedKeys), "rollback to v" + std::to_string(version), {});
+        return published->version;
+    }
+
+    // Versions still in the history, oldest first
+    std::vector<ConfigAuditEntry> auditLog() const {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        std::vector<ConfigAuditEntry> out;
+        for (const auto& revision : history) out.push_back(revision.audit);
+        return out;
+    }
+
+    // How many versions auditLog() and rollback() can reach (at least one)
+    void setHistoryLimit(size_t limit) {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        historyLimit = std::max<size_t>(limit, 1);
+        while (history.size() > historyLimit) history.pop_front();
+    }
+
+    // Writes the current snapshot in the binary snapshot format. The file is
+    // written beside the target and renamed over it, so a reader mapping
+    // path never sees a partial file. Throws std::runtime_error on I/O errors.
+    void exportSnapshot(const std::string& path) const {
+        // Flattens the precedence levels into one table of effective values
+        auto snapshot = std::atomic_load(&current);
+        FlatBytes bytes = buildFlatTable(snapshot->withPrefix(""), snapshot->version);
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!out.flush()) throw std::runtime_error("Cannot write " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Cannot rename " + tmp + ": " + std::strerror(errno));
+        }
+    }
+
+    // Immutable view of the current configuration for reading several keys
+    // consistently, e.g. once per request. The view shares ownership with
+    // the calling thread's holder rather than with the snapshot itself, so
+    // taking one increments a reference count no other thread touches;
+    // under many reader threads it does not bounce a shared cache line.
+    ConfigView snapshot() const {
+        const auto& holder = localHolder();
+        return ConfigView(std::shared_ptr<const ConfigSnapshot>(holder, holder->snapshot.get()));
+    }
+
+    // Resolves key once and returns a handle whose get() is a single atomic
+    // load (for strings, a shared_ptr load; see BoundSlot), kept current by
+    // every reload. Throws std::invalid_argument if
+    // the key does not exist or holds another type, so typos fail here
+    // instead of silently yielding defaultValue on every read. The default
+    // only applies if a later reload removes the key or changes its type.
+    template <typename T>
+    ConfigHandle<T> bind(const std::string& key, T defaultValue) {
+        static_assert(isConfigType<T>, "T must be one of the ConfigValue types");
+        std::lock_guard<std::mutex> lock(publishMutex);
+        auto snapshot = std::atomic_load(&current);
+        std::optional<ConfigValue> value = snapshot->value(key);
+        if (!value) {
+            throw std::invalid_argument("Unknown config key: " + key);
+        }
+        if (!std::holds_alternative<T>(*value)) {
+            throw std::invalid_argument("Config key " + key + " holds " + valueTypeName(*value) +
+                                        ", not " + valueTypeName(ConfigValue(T{})));
+        }
+        auto slot = std::make_shared<BoundSlot<T>>(key, std::move(defaultValue));
+        slot->refresh(*snapshot);
+        boundSlots.push_back(slot);
+        return ConfigHandle<T>(std::move(slot));
+    }
+
+    // Lock-free: a version check against the thread-local snapshot, then a
+    // perfect-hash probe per non-empty precedence level, highest first,
+    // until one has the key
+    template <typename T>
+    T getValue(const std::string& key, T defaultValue) const {
+        std::optional<T> value = localSnapshot().get<T>(key);
+        return value ? std::move(*value) : defaultValue;
+    }
+};
@@ -1,41 +1,25 @@
 #pragma once
 
 #include "LogCommon.hpp"
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include "../concurrency/UnboundedQueue.hpp"
+#include "../concurrency/WaitableQueue.hpp"
 #include <thread>
 #include <vector>
 #include <memory>
-#include <atomic>
 
+// Hands log messages from any number of threads to one worker thread.
+// The queue is lock-free and unbounded, so logging never blocks the caller;
+// the idle worker sleeps on an eventcount until a message arrives.
 class AsyncLogProcessor {
-    std::queue<LogMessage> queue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCv_;
+    WaitableQueue<UnboundedMPMCQueue<LogMessage>> queue_;
     std::thread workerThread_;
-    std::atomic<bool> stop_{false};
     std::vector<std::shared_ptr<ILogStrategy>>& strategies_;
 
     void process() {
-        while (true) {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCv_.wait(lock, [this]{ return !queue_.empty() || stop_; });
-
-            if (stop_ && queue_.empty()) return;
-
-            // Process all messages in the queue (batching could be added here)
-            // For now, process one by one but loop until empty to reduce locking overhead if we used pop separately
-            // However, typical implementation is one pop per loop iteration.
-            
-            // To ensure we process all items before exiting if stop_ is true:
-            // The condition (stop_ && queue_.empty()) handles the exit.
-            // If !queue_.empty(), we proceed.
-
-            LogMessage msg = queue_.front();
-            queue_.pop();
-            lock.unlock();
-
+        LogMessage msg;
+        // wait_dequeue returns false only after close() once the queue is
+        // empty, so every message logged before shutdown is written out
+        while (queue_.wait_dequeue(msg)) {
             // Dispatch to all strategies
             for (auto& strategy : strategies_) {
                 if (strategy) {
@@ -52,19 +36,11 @@ public:
     }
     
     void enqueue(LogMessage msg) {
-        {
-            std::lock_guard<std::mutex> lock(queueMutex_);
-            queue_.push(std::move(msg));
-        }
-        queueCv_.notify_one();
+        queue_.enqueue(std::move(msg));
     }
 
     ~AsyncLogProcessor() {
-        {
-            std::lock_guard<std::mutex> lock(queueMutex_);
-            stop_ = true;
-        }
-        queueCv_.notify_one();
+        queue_.close();
         if (workerThread_.joinable()) {
             workerThread_.join();
         }
@@ -1,171 +1,303 @@
+#include "concurrency/Concurrency.hpp"
 #include <iostream>
 #include <atomic>
 #include <vector>
 #include <thread>
 #include <optional>
-#include <cassert>
-
-/**
- * @brief A fixed-size Lock-Free Multiple Producer Multiple Consumer (MPMC) Queue.
- * 
- * Implementation based on Dmitry Vyukov's bounded MPMC queue.
- * It uses a ring buffer with sequence numbers to coordinate producers and consumers
- * without locks.
- */
-template<typename T>
-class MPMCQueue {
-private:
-    struct Cell {
-        std::atomic<size_t> sequence;
-        T data;
-    };
-
-    static const size_t CACHELINE_SIZE = 64;
-
-    std::vector<Cell> buffer_;
-    size_t buffer_mask_;
-    
-    // Padding to prevent false sharing between head and tail
-    alignas(CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_;
-    alignas(CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_;
-
-public:
-    MPMCQueue(size_t buffer_size) 
-        : buffer_(buffer_size), buffer_mask_(buffer_size - 1) {
-        // Buffer size must be a power of 2
-        assert((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0));
-
-        for (size_t i = 0; i < buffer_size; ++i) {
-            buffer_[i].sequence.store(i, std::memory_order_relaxed);
-        }
-        enqueue_pos_.store(0, std::memory_order_relaxed);
-        dequeue_pos_.store(0, std::memory_order_relaxed);
-    }
+#include <type_traits>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <cstdlib>
 
-    bool enqueue(const T& data) {
-        Cell* cell;
-        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
-
-        while (true) {
-            cell = &buffer_[pos & buffer_mask_];
-            size_t seq = cell->sequence.load(std::memory_order_acquire);
-            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
-
-            if (dif == 0) {
-                // The cell is free for writing (sequence == pos)
-                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
-                    // Success: we claimed this spot
-                    cell->data = data;
-                    // Increment sequence to allow reading (pos + 1)
-                    cell->sequence.store(pos + 1, std::memory_order_release);
-                    return true;
-                }
-            } else if (dif < 0) {
-                // Queue is full
-                return false;
-            } else {
-                // Sequence > pos: another producer moved enqueue_pos_ forward but hasn't updated the sequence yet?
-                // Or we loaded a stale 'pos'. Reload 'pos'.
-                pos = enqueue_pos_.load(std::memory_order_relaxed);
-            }
-        }
-    }
-
-    bool dequeue(T& data) {
-        Cell* cell;
-        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
-
-        while (true) {
-            cell = &buffer_[pos & buffer_mask_];
-            size_t seq = cell->sequence.load(std::memory_order_acquire);
-            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
-
-            if (dif == 0) {
-                // The cell is ready for reading (sequence == pos + 1)
-                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
-                    // Success: we claimed this spot
-                    data = cell->data;
-                    // Set sequence to pos + mask + 1 to indicate it's free for the NEXT lap
-                    cell->sequence.store(pos + buffer_mask_ + 1, std::memory_order_release);
-                    return true;
-                }
-            } else if (dif < 0) {
-                // Queue is empty
-                return false;
-            } else {
-                // Catch up
-                pos = dequeue_pos_.load(std::memory_order_relaxed);
-            }
-        }
-    }
-};
+// Demo and stress test for the queues in concurrency/.
 
 // --- Test Harness ---
+//
+// Stress checker. Every item carries its producer id, a per-producer
+// sequence number and a checksum of both. After each run the checker
+// verifies that:
+//   - each consumer saw every producer's items in increasing order
+//     (per-producer FIFO);
+//   - no item arrived torn;
+//   - every item was received exactly once.
+// Random rounds vary the queue kind, thread counts, capacity and the mix of
+// single, bulk and blocking calls. The seed is printed so that a failing round
+// can be replayed. Build with -fsanitize=thread to check the memory orders
+// in enqueue/dequeue as well.
 
 const int NUM_PRODUCERS = 4;
 const int NUM_CONSUMERS = 4;
 const int ITEMS_PER_PRODUCER = 100000;
 const size_t QUEUE_SIZE = 1024; // Power of 2
 
-void producer(MPMCQueue<int>& q, int id) {
-    for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
-        int val = id * ITEMS_PER_PRODUCER + i;
-        while (!q.enqueue(val)) {
-            std::this_thread::yield(); // Backoff strategy
+const int STRESS_ROUNDS = 20;                 // Default; override with argv[1]
+const uint32_t STRESS_MAX_ITEMS = 5000;       // Per producer in random rounds
+const size_t STRESS_MAX_BATCH = 16;           // Largest bulk call
+const std::chrono::seconds STRESS_TIMEOUT{60}; // Gives up on lost items
+
+struct StressItem {
+    uint32_t producer = 0;
+    uint32_t seq = 0;
+    uint64_t check = 0;
+
+    StressItem() = default;
+    StressItem(uint32_t p, uint32_t s) : producer(p), seq(s), check(checksum(p, s)) {}
+
+    static uint64_t checksum(uint32_t p, uint32_t s) {
+        uint64_t x = ((uint64_t)p << 32 | s) * 0x9E3779B97F4A7C15ull;
+        return x ^ (x >> 29);
+    }
+};
+
+struct StressConfig {
+    int producers;
+    int consumers;
+    size_t capacity;  // Reserve for the unbounded queue
+    uint32_t items_per_producer;
+};
+
+template<typename Q, typename = void>
+struct has_bulk : std::false_type {};
+template<typename Q>
+struct has_bulk<Q, std::void_t<decltype(std::declval<Q&>().dequeue_bulk(
+    std::declval<StressItem*>(), size_t(1)))>> : std::true_type {};
+
+template<typename Q, typename = void>
+struct is_waitable : std::false_type {};
+template<typename Q>
+struct is_waitable<Q, std::void_t<decltype(std::declval<Q&>().wait_dequeue(
+    std::declval<StressItem&>()))>> : std::true_type {};
+
+// Sends count items, picking enqueue, emplace, enqueue_bulk or
+// wait_enqueue at random for each step
+template<typename Q>
+void stress_producer(Q& q, uint32_t id, uint32_t count, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<StressItem> batch;
+    for (uint32_t seq = 0; seq < count; ) {
+        int op = (int)(rng() % 4);
+        if constexpr (has_bulk<Q>::value) {
+            if (op == 0) {
+                size_t n = std::min<size_t>(1 + rng() % STRESS_MAX_BATCH, count - seq);
+                batch.clear();
+                for (size_t j = 0; j < n; ++j) batch.emplace_back(id, seq + (uint32_t)j);
+                for (size_t sent = 0; sent < n; ) {
+                    size_t k = q.enqueue_bulk(batch.begin() + sent, n - sent);
+                    if (k == 0) std::this_thread::yield();
+                    sent += k;
+                }
+                seq += (uint32_t)n;
+                continue;
+            }
         }
+        if constexpr (is_waitable<Q>::value) {
+            if (op == 1) {
+                q.wait_enqueue(StressItem(id, seq++));
+                continue;
+            }
+        }
+        if (op == 2) {
+            while (!q.emplace(id, seq)) std::this_thread::yield();
+        } else {
+            StressItem item(id, seq);
+            while (!q.enqueue(item)) std::this_thread::yield();
+        }
+        ++seq;
     }
 }
 
-void consumer(MPMCQueue<int>& q, std::atomic<int>& total_consumed) {
-    int val;
-    int count = 0;
-    while (total_consumed.load(std::memory_order_relaxed) < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
-        if (q.dequeue(val)) {
-            total_consumed.fetch_add(1, std::memory_order_relaxed);
-            count++;
+// Receives until every item has been taken by some consumer, picking
+// dequeue, try_dequeue, dequeue_bulk or wait_dequeue_for at random
+template<typename Q>
+void stress_consumer(Q& q, std::atomic<int64_t>& remaining, uint64_t seed,
+                     std::chrono::steady_clock::time_point deadline,
+                     std::vector<StressItem>& received) {
+    std::mt19937_64 rng(seed);
+    std::vector<StressItem> batch(STRESS_MAX_BATCH);
+    StressItem item;
+    // remaining is relaxed so that it adds no ordering of its own
+    while (remaining.load(std::memory_order_relaxed) > 0) {
+        size_t got = 0;
+        int op = (int)(rng() % 4);
+        if constexpr (has_bulk<Q>::value) {
+            if (op == 0) {
+                got = q.dequeue_bulk(batch.begin(), 1 + rng() % STRESS_MAX_BATCH);
+                received.insert(received.end(), batch.begin(), batch.begin() + got);
+            }
+        }
+        if constexpr (is_waitable<Q>::value) {
+            if (op == 1 && q.wait_dequeue_for(item, std::chrono::milliseconds(1))) {
+                received.push_back(item);
+                got = 1;
+            }
+        }
+        if (op == 2) {
+            if (auto r = q.try_dequeue()) {
+                received.push_back(*r);
+                got = 1;
+            }
+        } else if (op == 3 && q.dequeue(item)) {
+            received.push_back(item);
+            got = 1;
+        }
+
+        if (got > 0) {
+            remaining.fetch_sub((int64_t)got, std::memory_order_relaxed);
+        } else if (std::chrono::steady_clock::now() > deadline) {
+            return;
         } else {
             std::this_thread::yield();
         }
     }
 }
 
-int main() {
-    MPMCQueue<int> queue(QUEUE_SIZE);
-    std::atomic<int> total_consumed{0};
+// Checks what the consumers received; prints the first problem found
+bool stress_verify(const StressConfig& cfg, const std::vector<std::vector<StressItem>>& logs) {
+    size_t per = cfg.items_per_producer;
+    std::vector<uint8_t> seen((size_t)cfg.producers * per, 0);
+    for (size_t c = 0; c < logs.size(); ++c) {
+        std::vector<int64_t> last(cfg.producers, -1);
+        for (const StressItem& item : logs[c]) {
+            if (item.producer >= (uint32_t)cfg.producers || item.seq >= per ||
+                item.check != StressItem::checksum(item.producer, item.seq)) {
+                std::cout << "  consumer " << c << ": corrupt item (producer " << item.producer
+                          << ", seq " << item.seq << ")" << std::endl;
+                return false;
+            }
+            if ((int64_t)item.seq <= last[item.producer]) {
+                std::cout << "  consumer " << c << ": producer " << item.producer << " seq "
+                          << item.seq << " after " << last[item.producer] << std::endl;
+                return false;
+            }
+            last[item.producer] = item.seq;
+            if (++seen[item.producer * per + item.seq] > 1) {
+                std::cout << "  duplicate: producer " << item.producer << " seq " << item.seq << std::endl;
+                return false;
+            }
+        }
+    }
+    auto missing = std::find(seen.begin(), seen.end(), 0);
+    if (missing != seen.end()) {
+        size_t i = missing - seen.begin();
+        std::cout << "  lost " << std::count(seen.begin(), seen.end(), 0) << " items, first: producer "
+                  << i / per << " seq " << i % per << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    std::cout << "Starting Lock-Free MPMC Queue Test..." << std::endl;
-    std::cout << "Producers: " << NUM_PRODUCERS << ", Consumers: " << NUM_CONSUMERS << std::endl;
-    std::cout << "Items per producer: " << ITEMS_PER_PRODUCER << std::endl;
+template<typename Q>
+bool stress_round(const StressConfig& cfg, uint64_t seed) {
+    Q queue(cfg.capacity);
+    std::atomic<int64_t> remaining{(int64_t)cfg.producers * cfg.items_per_producer};
+    std::vector<std::vector<StressItem>> logs(cfg.consumers);
+    auto deadline = std::chrono::steady_clock::now() + STRESS_TIMEOUT;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < cfg.producers; ++p) {
+        threads.emplace_back(stress_producer<Q>, std::ref(queue), (uint32_t)p,
+                             cfg.items_per_producer, seed + p);
+    }
+    for (int c = 0; c < cfg.consumers; ++c) {
+        threads.emplace_back(stress_consumer<Q>, std::ref(queue), std::ref(remaining),
+                             seed + cfg.producers + c, deadline, std::ref(logs[c]));
+    }
+    for (auto& t : threads) t.join();
 
-    std::vector<std::thread> producers;
-    std::vector<std::thread> consumers;
+    return stress_verify(cfg, logs);
+}
 
-    for (int i = 0; i < NUM_PRODUCERS; ++i) {
-        producers.emplace_back(producer, std::ref(queue), i);
-    }
+// One round on a random queue kind and shape; single-sided kinds get one
+// thread on that side. The unbounded queue uses tiny segments so that
+// segment hand-over and recycling happen constantly.
+bool stress_random_round(int round, std::mt19937_64& rng) {
+    StressConfig cfg;
+    cfg.producers = 1 + (int)(rng() % 6);
+    cfg.consumers = 1 + (int)(rng() % 6);
+    cfg.capacity = size_t(2) << (rng() % 10);
+    cfg.items_per_producer = 1 + (uint32_t)(rng() % STRESS_MAX_ITEMS);
+    uint64_t seed = rng();
 
-    for (int i = 0; i < NUM_CONSUMERS; ++i) {
-        consumers.emplace_back(consumer, std::ref(queue), std::ref(total_consumed));
+    const char* name;
+    bool ok;
+    switch (rng() % 8) {
+        case 0: name = "MPMC"; ok = stress_round<MPMCQueue<StressItem>>(cfg, seed); break;
+        case 1: name = "MPMC padded"; ok = stress_round<MPMCQueue<StressItem, CellLayout::Padded>>(cfg, seed); break;
+        case 2: name = "MPMC remapped"; ok = stress_round<MPMCQueue<StressItem, CellLayout::Remapped>>(cfg, seed); break;
+        case 3: name = "MPSC"; cfg.consumers = 1; ok = stress_round<MPSCQueue<StressItem>>(cfg, seed); break;
+        case 4: name = "SPMC"; cfg.producers = 1; ok = stress_round<SPMCQueue<StressItem>>(cfg, seed); break;
+        case 5: name = "SPSC"; cfg.producers = cfg.consumers = 1; ok = stress_round<SPSCQueue<StressItem>>(cfg, seed); break;
+        case 6: name = "Unbounded"; ok = stress_round<UnboundedMPMCQueue<StressItem, 8>>(cfg, seed); break;
+        default: name = "Waitable MPMC"; ok = stress_round<WaitableQueue<MPMCQueue<StressItem>>>(cfg, seed); break;
     }
+    std::cout << "Round " << round << ": " << name << " " << cfg.producers << "x" << cfg.consumers
+              << ", capacity " << cfg.capacity << ", " << cfg.items_per_producer
+              << " items/producer: " << (ok ? "OK" : "FAILED") << std::endl;
+    return ok;
+}
 
-    for (auto& t : producers) t.join();
-    for (auto& t : consumers) t.join();
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : STRESS_ROUNDS;
+    uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::random_device{}();
+
+    std::cout << "Starting Lock-Free MPMC Queue Test..." << std::endl;
+    std::cout << "Producers: " << NUM_PRODUCERS << ", Consumers: " << NUM_CONSUMERS << std::endl;
+    std::cout << "Items per producer: " << ITEMS_PER_PRODUCER << std::endl;
 
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = stress_round<WaitableQueue<MPMCQueue<StressItem>>>(
+        {NUM_PRODUCERS, NUM_CONSUMERS, QUEUE_SIZE, ITEMS_PER_PRODUCER}, seed);
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> diff = end - start;
 
     std::cout << "Test Finished." << std::endl;
-    std::cout << "Total Consumed: " << total_consumed << " / " << (NUM_PRODUCERS * ITEMS_PER_PRODUCER) << std::endl;
     std::cout << "Time: " << diff.count() << " seconds" << std::endl;
     std::cout << "Throughput: " << (NUM_PRODUCERS * ITEMS_PER_PRODUCER) / diff.count() / 1000000.0 << " M ops/sec" << std::endl;
 
-    if (total_consumed == NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
-        std::cout << "SUCCESS!" << std::endl;
-    } else {
-        std::cout << "FAILURE!" << std::endl;
+    // Randomised rounds; rerun with the same seed to replay a failure
+    std::cout << "Stress rounds: " << rounds << ", seed: " << seed << std::endl;
+    std::mt19937_64 rng(seed);
+    for (int r = 1; r <= rounds; ++r) {
+        ok = stress_random_round(r, rng) && ok;
+    }
+
+    // close() releases a consumer parked on an empty queue
+    WaitableQueue<MPMCQueue<int>> closing(4);
+    bool released = false;
+    std::thread waiter([&] {
+        int val;
+        released = !closing.wait_dequeue(val);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    closing.close();
+    waiter.join();
+    std::cout << "Close released parked consumer: " << (released ? "yes" : "no") << std::endl;
+    ok = ok && released;
+
+    std::cout << (ok ? "SUCCESS!" : "FAILURE!") << std::endl;
+
+    // Move-only payloads are constructed in place and moved out, never copied
+    MPMCQueue<std::unique_ptr<std::string>> ptr_queue(4);
+    ptr_queue.emplace(std::make_unique<std::string>("moved, not copied"));
+    if (auto item = ptr_queue.try_dequeue()) {
+        std::cout << "Move-only payload: " << **item << std::endl;
+    }
+
+    // A burst far beyond any fixed capacity: the unbounded variant links
+    // more segments instead of failing, and recycles them once drained
+    UnboundedMPMCQueue<int> unbounded;
+    for (int i = 0; i < 100000; ++i) {
+        unbounded.enqueue(i);
+    }
+    int drained = 0;
+    for (int val; unbounded.dequeue(val); ) {
+        ++drained;
     }
+    std::cout << "Unbounded burst drained: " << drained << " items" << std::endl;
 
-    return 0;
+    return ok ? 0 : 1;
 }
@@ -1,3 +1,4 @@
+#include "concurrency/Concurrency.hpp"
 #include <iostream>
 #include <atomic>
 #include <vector>
@@ -6,76 +7,27 @@
 #include <condition_variable>
 #include <queue>
 #include <chrono>
-#include <cassert>
 #include <iomanip>
+#include <algorithm>
+#include <string>
+#include <optional>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 // ==========================================
-// 1. Lock-Free MPMC Queue (From previous step)
-// ==========================================
-template<typename T>
-class MPMCQueue {
-private:
-    struct Cell {
-        std::atomic<size_t> sequence;
-        T data;
-    };
-
-    static const size_t CACHELINE_SIZE = 64;
-    std::vector<Cell> buffer_;
-    size_t buffer_mask_;
-    alignas(CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_;
-    alignas(CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_;
-
-public:
-    MPMCQueue(size_t buffer_size) 
-        : buffer_(buffer_size), buffer_mask_(buffer_size - 1) {
-        assert((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0));
-        for (size_t i = 0; i < buffer_size; ++i) {
-            buffer_[i].sequence.store(i, std::memory_order_relaxed);
-        }
-        enqueue_pos_.store(0, std::memory_order_relaxed);
-        dequeue_pos_.store(0, std::memory_order_relaxed);
-    }
-
-    bool enqueue(const T& data) {
-        Cell* cell;
-        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
-        while (true) {
-            cell = &buffer_[pos & buffer_mask_];
-            size_t seq = cell->sequence.load(std::memory_order_acquire);
-            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
-            if (dif == 0) {
-                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
-                    cell->data = data;
-                    cell->sequence.store(pos + 1, std::memory_order_release);
-                    return true;
-                }
-            } else if (dif < 0) return false;
-            else pos = enqueue_pos_.load(std::memory_order_relaxed);
-        }
-    }
-
-    bool dequeue(T& data) {
-        Cell* cell;
-        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
-        while (true) {
-            cell = &buffer_[pos & buffer_mask_];
-            size_t seq = cell->sequence.load(std::memory_order_acquire);
-            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
-            if (dif == 0) {
-                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
-                    data = cell->data;
-                    cell->sequence.store(pos + buffer_mask_ + 1, std::memory_order_release);
-                    return true;
-                }
-            } else if (dif < 0) return false;
-            else pos = dequeue_pos_.load(std::memory_order_relaxed);
-        }
-    }
-};
-
-// ==========================================
-// 2. Standard Blocking Queue (Mutex + CV)
+// 1. Standard Blocking Queue (Mutex + CV)
 // ==========================================
 template<typename T>
 class BlockingQueue {
@@ -86,6 +38,8 @@ class BlockingQueue {
     size_t capacity_;
 
 public:
+    using value_type = T;
+
     BlockingQueue(size_t capacity) : capacity_(capacity) {}
 
     bool enqueue(const T& data) {
@@ -98,11 +52,9 @@ public:
 
     bool dequeue(T& data) {
         std::unique_lock<std::mutex> lock(mutex_);
-        // Wait with timeout to avoid deadlock at the end of benchmark
-        if (!not_empty_.wait_for(lock, std::chrono::milliseconds(10), [this]{ return !queue_.empty(); })) {
-            return false;
-        }
-        data = queue_.front();
+        // No timeout: every run ends with one stop item per consumer
+        not_empty_.wait(lock, [this]{ return !queue_.empty(); });
+        data = std::move(queue_.front());
         queue_.pop();
         not_full_.notify_one();
         return true;
@@ -110,87 +62,916 @@ public:
 };
 
 // ==========================================
-// 3. Benchmark Harness
+// 2. Payloads and Measurement
 // ==========================================
 
-const int NUM_PRODUCERS = 16;
-const int NUM_CONSUMERS = 16;
-const int ITEMS_PER_PRODUCER = 250000; // Total 4 Million items
-const size_t QUEUE_SIZE = 65536; // Larger queue for high throughput
-
-template<typename Q>
-void producer(Q& q, int id) {
-    for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
-        int val = id * ITEMS_PER_PRODUCER + i;
-        // Lock-Free MPMC returns false if full, so we loop.
-        // BlockingQueue returns true always (blocks internally).
-        // This handles both (if enqueue returns bool).
-        while (!q.enqueue(val)) {
-            std::this_thread::yield();
-        }
-    }
-}
-
-template<typename Q>
-void consumer(Q& q, std::atomic<int>& total_consumed) {
-    int val;
-    while (total_consumed.load(std::memory_order_relaxed) < NUM_PRODUCERS * ITEMS_PER_PRODUCER) {
-        // MPMC returns false if empty. BlockingQueue blocks.
-        // We need a way to stop BlockingQueue consumers if using wait.
-        // But for MPMC we spin.
-        // To support BlockingQueue properly in this generic harness is tricky 
-        // without a "Shutdown" signal.
-        // However, standard Blocking Queue benchmark usually compares "Wait/Notify" vs "Spinning".
-        
-        // For this specific benchmark, we will use a version of consumer 
-        // that handles the specific queue type behavior or just rely on the fact 
-        // that we know how many items to consume.
-        
-        if (q.dequeue(val)) {
-             total_consumed.fetch_add(1, std::memory_order_relaxed);
-        } else {
-             std::this_thread::yield();
+// Fixed-size item. seq identifies the item in throughput runs and carries the
+// send timestamp in latency runs; the padding makes copy cost and cells per
+// cache line follow the payload size under test.
+template<size_t Bytes>
+struct Payload {
+    static_assert(Bytes >= sizeof(uint64_t), "Payload must hold the sequence number");
+    uint64_t seq = 0;
+    std::array<char, Bytes - sizeof(uint64_t)> pad{};
+};
+
+// Enqueued once per consumer after all producers finished. Consumers stop
+// when they receive it, so no shared progress counter sits in the hot path.
+static constexpr uint64_t STOP_SEQ = UINT64_MAX;
+
+inline uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Timestamp counter used to stamp items in latency runs. Falls back to the
+// steady clock where there is no rdtsc. One-way latencies compare counters of
+// different cores, which assumes an invariant, synchronised TSC.
+inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+// Nanoseconds per read_tsc() tick, calibrated once against the steady clock
+inline double tsc_ns_per_tick() {
+    static const double ratio = [] {
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t t0 = now_ns();
+        uint64_t c0 = read_tsc();
+        while (now_ns() - t0 < 20000000) {}  // 20 ms
+        uint64_t t1 = now_ns();
+        uint64_t c1 = read_tsc();
+        return (double)(t1 - t0) / (double)(c1 - c0);
+#else
+        return 1.0;
+#endif
+    }();
+    return ratio;
+}
+
+// Nanoseconds since a read_tsc() stamp
+inline uint64_t ns_since(uint64_t stamp) {
+    uint64_t now = read_tsc();
+    return now > stamp ? (uint64_t)((double)(now - stamp) * tsc_ns_per_tick()) : 0;
+}
+
+/**
+ * @brief Log-linear latency histogram in nanoseconds.
+ *
+ * Each power of two is split into 16 linear buckets, so a reported
+ * percentile is within about 6% of the true value over the full uint64 range
+ * with a fixed 8 KB footprint. Per-thread instances are merged after a run.
+ */
+class LatencyHistogram {
+    static constexpr int SUB_BITS = 4;
+    static constexpr size_t SUB_COUNT = size_t(1) << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    std::vector<uint64_t> counts_ = std::vector<uint64_t>(BUCKETS);
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+
+    static size_t bucket_of(uint64_t v) {
+        if (v < SUB_COUNT) return (size_t)v;
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return (size_t)(shift + 1) * SUB_COUNT + ((v >> shift) & (SUB_COUNT - 1));
+    }
+
+    // Largest value that falls into bucket b
+    static uint64_t upper_bound_of(size_t b) {
+        if (b < SUB_COUNT) return b;
+        int shift = (int)(b / SUB_COUNT) - 1;
+        uint64_t mantissa = SUB_COUNT + b % SUB_COUNT;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t ns) {
+        ++counts_[bucket_of(ns)];
+        ++total_;
+        max_ = std::max(max_, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t b = 0; b < BUCKETS; ++b) counts_[b] += other.counts_[b];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+
+    // Smallest bucket bound at or below which a fraction p of samples fall
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p * (double)total_));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) return std::min(upper_bound_of(b), max_);
         }
+        return max_;
     }
+};
+
+/**
+ * @brief Times every n-th operation of one thread.
+ *
+ * An operation is timed from its first attempt until it succeeds, so retries
+ * on a full/empty queue and blocking waits count towards its latency, as they
+ * would for a caller handing work to another thread.
+ */
+class OpTimer {
+    size_t every_;
+    size_t countdown_ = 1;
+    uint64_t start_ = 0;
+    bool timing_ = false;
+
+public:
+    explicit OpTimer(size_t every) : every_(every) {}
+
+    void begin() {
+        timing_ = every_ != 0 && --countdown_ == 0;
+        if (timing_) {
+            countdown_ = every_;
+            start_ = now_ns();
+        }
+    }
+
+    void end(LatencyHistogram& histogram) {
+        if (timing_) histogram.record(now_ns() - start_);
+    }
+};
+
+struct Summary {
+    double median = 0;
+    double mean = 0;
+    double stddev = 0;  // Sample standard deviation; 0 for a single run
+};
+
+inline Summary summarize(std::vector<double> samples) {
+    Summary s;
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    s.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    for (double v : samples) s.mean += v;
+    s.mean /= (double)n;
+    if (n > 1) {
+        double sq = 0;
+        for (double v : samples) sq += (v - s.mean) * (v - s.mean);
+        s.stddev = std::sqrt(sq / (double)(n - 1));
+    }
+    return s;
 }
 
-template<typename QueueType>
-void run_benchmark(const std::string& name) {
-    QueueType queue(QUEUE_SIZE);
-    std::atomic<int> total_consumed{0};
+// ==========================================
+// 3. Workers
+// ==========================================
+
+enum class Mode { Spin, Bulk, Park };
+
+const size_t BATCH_SIZE = 256;  // Items per enqueue_bulk/dequeue_bulk call
+
+// Results of one thread; aligned so neighbouring threads never share a line
+struct alignas(CACHELINE_SIZE) WorkerStats {
+    LatencyHistogram latency;
+    uint64_t items = 0;
+};
+
+// Single-item transfer in the given mode: retry with yield, or park
+template<Mode M, typename Q, typename Item>
+void send(Q& q, const Item& item) {
+    if constexpr (M == Mode::Park) {
+        q.wait_enqueue(item);
+    } else {
+        while (!q.enqueue(item)) std::this_thread::yield();
+    }
+}
+
+template<Mode M, typename Q, typename Item>
+void receive(Q& q, Item& item) {
+    if constexpr (M == Mode::Park) {
+        q.wait_dequeue(item);
+    } else {
+        while (!q.dequeue(item)) std::this_thread::yield();
+    }
+}
+
+// A bulk call moves up to BATCH_SIZE items; sample calls about as densely as
+// items are sampled in the other modes
+inline size_t bulk_sampling(size_t sample_every) {
+    return sample_every == 0 ? 0 : std::max<size_t>(1, sample_every / BATCH_SIZE);
+}
+
+// Spin: retry with yield. Bulk: batches of BATCH_SIZE, one latency sample per
+// call. Park: WaitableQueue's blocking calls. BlockingQueue blocks by itself.
+template<Mode M, typename Q>
+void produce(Q& q, uint64_t first, uint64_t count, size_t sample_every, WorkerStats& stats) {
+    using Item = typename Q::value_type;
+    OpTimer timer(M == Mode::Bulk ? bulk_sampling(sample_every) : sample_every);
+    if constexpr (M == Mode::Bulk) {
+        std::vector<Item> batch(BATCH_SIZE);
+        for (uint64_t i = 0; i < count; ) {
+            size_t n = (size_t)std::min<uint64_t>(BATCH_SIZE, count - i);
+            for (size_t j = 0; j < n; ++j) batch[j].seq = first + i + j;
+            for (size_t sent = 0; sent < n; ) {
+                timer.begin();
+                size_t k;
+                while ((k = q.enqueue_bulk(batch.begin() + sent, n - sent)) == 0) {
+                    std::this_thread::yield();
+                }
+                timer.end(stats.latency);
+                sent += k;
+            }
+            i += n;
+        }
+    } else {
+        Item item;
+        for (uint64_t i = 0; i < count; ++i) {
+            item.seq = first + i;
+            timer.begin();
+            send<M>(q, item);
+            timer.end(stats.latency);
+        }
+    }
+    stats.items = count;
+}
+
+template<Mode M, typename Q>
+void consume(Q& q, size_t sample_every, WorkerStats& stats) {
+    using Item = typename Q::value_type;
+    OpTimer timer(M == Mode::Bulk ? bulk_sampling(sample_every) : sample_every);
+    if constexpr (M == Mode::Bulk) {
+        std::vector<Item> batch(BATCH_SIZE);
+        for (;;) {
+            timer.begin();
+            size_t k;
+            while ((k = q.dequeue_bulk(batch.begin(), BATCH_SIZE)) == 0) {
+                std::this_thread::yield();
+            }
+            timer.end(stats.latency);
+            // Stop items trail every real item, so they end the batch
+            size_t stops = (size_t)std::count_if(batch.begin(), batch.begin() + k,
+                [](const Item& it) { return it.seq == STOP_SEQ; });
+            stats.items += k - stops;
+            if (stops > 0) {
+                // Hand back the stop items meant for other consumers
+                Item stop;
+                stop.seq = STOP_SEQ;
+                for (size_t s = 1; s < stops; ++s) {
+                    while (!q.enqueue(stop)) std::this_thread::yield();
+                }
+                return;
+            }
+        }
+    } else {
+        Item item;
+        for (;;) {
+            timer.begin();
+            receive<M>(q, item);
+            if (item.seq == STOP_SEQ) return;
+            timer.end(stats.latency);
+            ++stats.items;
+        }
+    }
+}
+
+// Burst test: sends count stamped items in bursts of burst, pausing gap_us
+// between bursts so the consumers drain the queue in between
+template<Mode M, typename Q>
+void produce_bursts(Q& q, uint64_t count, size_t burst, unsigned gap_us) {
+    typename Q::value_type item;
+    for (uint64_t i = 0; i < count; ) {
+        for (size_t j = 0; j < burst && i < count; ++j, ++i) {
+            item.seq = read_tsc();
+            send<M>(q, item);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+    }
+}
+
+// Records send-to-receipt time of every item, including time spent queued
+// behind the rest of its burst
+template<Mode M, typename Q>
+void consume_stamped(Q& q, WorkerStats& stats) {
+    typename Q::value_type item;
+    for (;;) {
+        receive<M>(q, item);
+        if (item.seq == STOP_SEQ) return;
+        stats.latency.record(ns_since(item.seq));
+        ++stats.items;
+    }
+}
+
+// ==========================================
+// 4. Runner
+// ==========================================
+
+// CPUs this process may run on; threads are pinned round-robin over them
+inline const std::vector<int>& allowed_cpus() {
+    static const std::vector<int> cpus = [] {
+        std::vector<int> list;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; ++c) {
+                if (CPU_ISSET(c, &set)) list.push_back(c);
+            }
+        }
+#endif
+        return list;
+    }();
+    return cpus;
+}
+
+inline void pin_to_cpu(size_t slot) {
+#if defined(__linux__)
+    const auto& cpus = allowed_cpus();
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[slot % cpus.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)slot;
+#endif
+}
+
+// Threads check in here after start-up and pinning, so neither is timed
+class StartGate {
+    std::atomic<int> ready_{0};
+    std::atomic<bool> open_{false};
+
+public:
+    void arrive_and_wait() {
+        ready_.fetch_add(1, std::memory_order_acq_rel);
+        while (!open_.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    void wait_for(int threads) {
+        while (ready_.load(std::memory_order_acquire) < threads) std::this_thread::yield();
+    }
+
+    void open() { open_.store(true, std::memory_order_release); }
+};
+
+// throughput: sustained transfer; pingpong: round trip between two threads
+// over a request and a reply queue; burst: one-way latency under bursts
+enum class Test { Throughput, PingPong, Burst };
+
+struct Options {
+    Test test = Test::Throughput;
+    std::vector<std::string> queues;
+    std::vector<int> producers{1, 4, 16};
+    std::vector<int> consumers{1, 4, 16};
+    std::vector<size_t> payloads{8, 64};
+    std::vector<size_t> capacities{65536};
+    uint64_t items = 0;  // Defaults per test, see finalize in parse_options
+    size_t burst = 64;
+    unsigned gap_us = 100;
+    int reps = 5;
+    int warmup = 1;
+    size_t sample_every = 64;
+    bool pin = true;
+    std::string format = "table";
+};
 
-    std::cout << "------------------------------------------------" << std::endl;
-    std::cout << "Benchmarking: " << name << std::endl;
-    
-    auto start = std::chrono::high_resolution_clock::now();
+// Latency tests leave the measured item latency in dequeue_latency
+struct RunResult {
+    double seconds = 0;
+    uint64_t consumed = 0;
+    LatencyHistogram enqueue_latency;
+    LatencyHistogram dequeue_latency;
+};
 
+// Runs producer_fn(queue, first, count, stats) on each producer and
+// consumer_fn(queue, stats) on each consumer, then stops the consumers
+template<typename Q, Mode M, typename ProducerFn, typename ConsumerFn>
+RunResult run_threads(const Options& opt, size_t capacity, int num_producers, int num_consumers,
+                      ProducerFn producer_fn, ConsumerFn consumer_fn) {
+    using Item = typename Q::value_type;
+    Q queue(capacity);
+    std::vector<WorkerStats> producer_stats(num_producers);
+    std::vector<WorkerStats> consumer_stats(num_consumers);
+    StartGate gate;
     std::vector<std::thread> producers;
     std::vector<std::thread> consumers;
 
-    for (int i = 0; i < NUM_PRODUCERS; ++i) 
-        producers.emplace_back(producer<QueueType>, std::ref(queue), i);
+    uint64_t per_producer = opt.items / num_producers;
+    uint64_t remainder = opt.items % num_producers;
+    size_t slot = 0;
+    for (int p = 0; p < num_producers; ++p) {
+        uint64_t first = p * per_producer + std::min<uint64_t>(p, remainder);
+        uint64_t count = per_producer + ((uint64_t)p < remainder ? 1 : 0);
+        producers.emplace_back([&, p, first, count, cpu = slot++] {
+            if (opt.pin) pin_to_cpu(cpu);
+            gate.arrive_and_wait();
+            producer_fn(queue, first, count, producer_stats[p]);
+        });
+    }
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&, c, cpu = slot++] {
+            if (opt.pin) pin_to_cpu(cpu);
+            gate.arrive_and_wait();
+            consumer_fn(queue, consumer_stats[c]);
+        });
+    }
 
-    for (int i = 0; i < NUM_CONSUMERS; ++i) 
-        consumers.emplace_back(consumer<QueueType>, std::ref(queue), std::ref(total_consumed));
+    gate.wait_for(num_producers + num_consumers);
+    auto start = std::chrono::steady_clock::now();
+    gate.open();
 
     for (auto& t : producers) t.join();
+    // Queued behind every real item, after the producers are done, so the
+    // single-producer variants still see one producer at a time
+    Item stop;
+    stop.seq = STOP_SEQ;
+    for (int c = 0; c < num_consumers; ++c) send<M>(queue, stop);
     for (auto& t : consumers) t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    for (const auto& s : producer_stats) result.enqueue_latency.merge(s.latency);
+    for (const auto& s : consumer_stats) {
+        result.dequeue_latency.merge(s.latency);
+        result.consumed += s.items;
+    }
+    return result;
+}
+
+// One client stamps each item and sends it on a request queue; an echo thread
+// returns it on a reply queue. Every round trip is recorded.
+template<typename Q, Mode M>
+RunResult run_pingpong(const Options& opt, size_t capacity) {
+    using Item = typename Q::value_type;
+    Q request(capacity);
+    Q reply(capacity);
+    WorkerStats client_stats;
+    StartGate gate;
+
+    std::thread echo([&] {
+        if (opt.pin) pin_to_cpu(1);
+        gate.arrive_and_wait();
+        Item item;
+        for (;;) {
+            receive<M>(request, item);
+            if (item.seq == STOP_SEQ) return;
+            send<M>(reply, item);
+        }
+    });
+    std::thread client([&] {
+        if (opt.pin) pin_to_cpu(0);
+        gate.arrive_and_wait();
+        Item item;
+        for (uint64_t i = 0; i < opt.items; ++i) {
+            item.seq = read_tsc();
+            send<M>(request, item);
+            receive<M>(reply, item);
+            client_stats.latency.record(ns_since(item.seq));
+            ++client_stats.items;
+        }
+        item.seq = STOP_SEQ;
+        send<M>(request, item);
+    });
+
+    gate.wait_for(2);
+    auto start = std::chrono::steady_clock::now();
+    gate.open();
+    client.join();
+    echo.join();
+    auto end = std::chrono::steady_clock::now();
+
+    RunResult result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.consumed = client_stats.items;
+    result.dequeue_latency.merge(client_stats.latency);
+    return result;
+}
+
+template<typename Q, Mode M>
+RunResult run_test(const Options& opt, size_t capacity, int np, int nc) {
+    switch (opt.test) {
+        case Test::PingPong:
+            return run_pingpong<Q, M>(opt, capacity);
+        case Test::Burst:
+            return run_threads<Q, M>(opt, capacity, np, nc,
+                [&](Q& q, uint64_t, uint64_t count, WorkerStats& stats) {
+                    produce_bursts<M>(q, count, opt.burst, opt.gap_us);
+                    stats.items = count;
+                },
+                [](Q& q, WorkerStats& stats) { consume_stamped<M>(q, stats); });
+        default:
+            return run_threads<Q, M>(opt, capacity, np, nc,
+                [&](Q& q, uint64_t first, uint64_t count, WorkerStats& stats) {
+                    produce<M>(q, first, count, opt.sample_every, stats);
+                },
+                [&](Q& q, WorkerStats& stats) { consume<M>(q, opt.sample_every, stats); });
+    }
+}
+
+// Queue kinds selectable with --queues. Single-sided variants only run on
+// thread shapes they support.
+struct QueueKind {
+    const char* name;
+    bool single_producer;
+    bool single_consumer;
+    bool bulk;  // Moves items in batches; throughput test only
+    const char* description;
+};
+
+const QueueKind QUEUE_KINDS[] = {
+    {"mpmc",          false, false, false, "Lock-free MPMC queue"},
+    {"mpmc-padded",   false, false, false, "Lock-free MPMC queue, padded cells"},
+    {"mpmc-remapped", false, false, false, "Lock-free MPMC queue, remapped cells"},
+    {"mpmc-bulk",     false, false, true,  "Lock-free MPMC queue, bulk calls"},
+    {"mpsc",          false, true,  false, "MPSC queue"},
+    {"spmc",          true,  false, false, "SPMC queue"},
+    {"spsc",          true,  true,  false, "SPSC queue"},
+    {"unbounded",     false, false, false, "Unbounded segmented MPMC queue (capacity = reserve)"},
+    {"waitable",      false, false, false, "Lock-free MPMC queue with parking waits"},
+    {"mutex",         false, false, false, "Standard mutex + condition variable queue"},
+};
 
-    auto end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = end - start;
-    double throughput = (NUM_PRODUCERS * ITEMS_PER_PRODUCER) / diff.count() / 1000000.0;
+template<typename Item>
+RunResult run_kind(const std::string& kind, const Options& opt, size_t capacity, int np, int nc) {
+    if (kind == "mpmc") return run_test<MPMCQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "mpmc-padded") return run_test<MPMCQueue<Item, CellLayout::Padded>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "mpmc-remapped") return run_test<MPMCQueue<Item, CellLayout::Remapped>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "mpmc-bulk") return run_test<MPMCQueue<Item>, Mode::Bulk>(opt, capacity, np, nc);
+    if (kind == "mpsc") return run_test<MPSCQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "spmc") return run_test<SPMCQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "spsc") return run_test<SPSCQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "unbounded") return run_test<UnboundedMPMCQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+    if (kind == "waitable") return run_test<WaitableQueue<MPMCQueue<Item>>, Mode::Park>(opt, capacity, np, nc);
+    return run_test<BlockingQueue<Item>, Mode::Spin>(opt, capacity, np, nc);
+}
+
+// ==========================================
+// 5. Reporting
+// ==========================================
 
-    std::cout << "Time:       " << std::fixed << std::setprecision(4) << diff.count() << " s" << std::endl;
-    std::cout << "Throughput: " << std::fixed << std::setprecision(4) << throughput << " M ops/sec" << std::endl;
+inline const char* test_name(Test test) {
+    switch (test) {
+        case Test::PingPong: return "pingpong";
+        case Test::Burst: return "burst";
+        default: return "throughput";
+    }
 }
 
-int main() {
-    std::cout << "Benchmark Configuration:" << std::endl;
-    std::cout << "Producers: " << NUM_PRODUCERS << ", Consumers: " << NUM_CONSUMERS << std::endl;
-    std::cout << "Total Items: " << (NUM_PRODUCERS * ITEMS_PER_PRODUCER) << std::endl;
+struct Row {
+    std::string queue;
+    size_t payload;
+    size_t capacity;
+    int producers;
+    int consumers;
+    Summary mops;  // Million items per second over the measured repetitions
+    LatencyHistogram enqueue_latency;
+    LatencyHistogram dequeue_latency;  // Item latency in latency tests
+};
+
+class Reporter {
+    std::string format_;
+    bool first_ = true;
 
-    run_benchmark<MPMCQueue<int>>("Lock-Free MPMC Queue");
-    run_benchmark<BlockingQueue<int>>("Standard Mutex Queue");
-    
+    static void latency_fields(std::ostream& os, const LatencyHistogram& h, const char* sep) {
+        os << h.percentile(0.50) << sep << h.percentile(0.99) << sep
+           << h.percentile(0.999) << sep << h.max();
+    }
+
+    static void latency_json(std::ostream& os, const char* key, const LatencyHistogram& h) {
+        os << "\"" << key << "\":{\"samples\":" << h.count()
+           << ",\"p50\":" << h.percentile(0.50) << ",\"p99\":" << h.percentile(0.99)
+           << ",\"p999\":" << h.percentile(0.999) << ",\"max\":" << h.max() << "}";
+    }
+
+    // Latency tests report one histogram per row instead of throughput
+    void begin_latency(const Options& opt) {
+        if (format_ == "csv") {
+            std::cout << "test,queue,payload,capacity,producers,consumers,items,reps,"
+                         "samples,p50_ns,p99_ns,p999_ns,max_ns\n";
+        } else if (format_ == "json") {
+            std::cout << "[\n";
+        } else {
+            std::cout << "Test: " << test_name(opt.test) << ", items per run: " << opt.items
+                      << ", warm-up: " << opt.warmup << ", repetitions: " << opt.reps
+                      << ", pinned: " << (opt.pin ? "yes" : "no");
+            if (opt.test == Test::Burst) {
+                std::cout << ", burst: " << opt.burst << ", gap: " << opt.gap_us << " us";
+            }
+            std::cout << "\n"
+                      << (opt.test == Test::PingPong ? "Round-trip" : "Send-to-receipt")
+                      << " latency of every item in ns, all repetitions merged\n\n"
+                      << std::left << std::setw(15) << "queue" << std::right
+                      << std::setw(8) << "payload" << std::setw(9) << "capacity"
+                      << std::setw(7) << "PxC" << std::setw(10) << "samples"
+                      << std::setw(9) << "p50" << std::setw(9) << "p99"
+                      << std::setw(9) << "p99.9" << std::setw(11) << "max" << std::endl;
+        }
+    }
+
+    void row_latency(const Options& opt, const Row& r) {
+        const LatencyHistogram& h = r.dequeue_latency;
+        if (format_ == "csv") {
+            std::cout << test_name(opt.test) << "," << r.queue << "," << r.payload << ","
+                      << r.capacity << "," << r.producers << "," << r.consumers << ","
+                      << opt.items << "," << opt.reps << "," << h.count() << ",";
+            latency_fields(std::cout, h, ",");
+            std::cout << std::endl;
+        } else if (format_ == "json") {
+            if (!first_) std::cout << ",\n";
+            std::cout << "  {\"test\":\"" << test_name(opt.test) << "\",\"queue\":\"" << r.queue
+                      << "\",\"payload\":" << r.payload << ",\"capacity\":" << r.capacity
+                      << ",\"producers\":" << r.producers << ",\"consumers\":" << r.consumers
+                      << ",\"items\":" << opt.items << ",\"reps\":" << opt.reps << ",";
+            latency_json(std::cout, "latency_ns", h);
+            std::cout << "}" << std::flush;
+        } else {
+            std::ostringstream shape;
+            shape << r.producers << "x" << r.consumers;
+            std::cout << std::left << std::setw(15) << r.queue << std::right
+                      << std::setw(8) << r.payload << std::setw(9) << r.capacity
+                      << std::setw(7) << shape.str() << std::setw(10) << h.count()
+                      << std::setw(9) << h.percentile(0.50) << std::setw(9) << h.percentile(0.99)
+                      << std::setw(9) << h.percentile(0.999) << std::setw(11) << h.max() << std::endl;
+        }
+        first_ = false;
+    }
+
+public:
+    explicit Reporter(std::string format) : format_(std::move(format)) {}
+
+    void begin(const Options& opt) {
+        if (opt.test != Test::Throughput) {
+            begin_latency(opt);
+            return;
+        }
+        if (format_ == "csv") {
+            std::cout << "queue,payload,capacity,producers,consumers,items,reps,"
+                         "median_mops,mean_mops,stddev_mops,"
+                         "enq_p50_ns,enq_p99_ns,enq_p999_ns,enq_max_ns,"
+                         "deq_p50_ns,deq_p99_ns,deq_p999_ns,deq_max_ns\n";
+        } else if (format_ == "json") {
+            std::cout << "[\n";
+        } else {
+            std::cout << "Items per run: " << opt.items << ", warm-up: " << opt.warmup
+                      << ", repetitions: " << opt.reps
+                      << ", latency sample: 1/" << opt.sample_every
+                      << ", pinned: " << (opt.pin ? "yes" : "no") << "\n"
+                      << "Latencies in ns as p50/p99/p99.9/max; an operation is timed until it succeeds\n\n"
+                      << std::left << std::setw(15) << "queue" << std::right
+                      << std::setw(8) << "payload" << std::setw(9) << "capacity"
+                      << std::setw(7) << "PxC" << std::setw(11) << "Mops/s"
+                      << std::setw(9) << "stddev" << "  "
+                      << std::left << std::setw(30) << "enqueue latency"
+                      << "dequeue latency" << std::right << std::endl;
+        }
+    }
+
+    void row(const Options& opt, const Row& r) {
+        if (opt.test != Test::Throughput) {
+            row_latency(opt, r);
+            return;
+        }
+        if (format_ == "csv") {
+            std::cout << r.queue << "," << r.payload << "," << r.capacity << ","
+                      << r.producers << "," << r.consumers << "," << opt.items << ","
+                      << opt.reps << "," << std::fixed << std::setprecision(4)
+                      << r.mops.median << "," << r.mops.mean << "," << r.mops.stddev << ",";
+            latency_fields(std::cout, r.enqueue_latency, ",");
+            std::cout << ",";
+            latency_fields(std::cout, r.dequeue_latency, ",");
+            std::cout << std::endl;
+        } else if (format_ == "json") {
+            if (!first_) std::cout << ",\n";
+            std::cout << "  {\"queue\":\"" << r.queue << "\",\"payload\":" << r.payload
+                      << ",\"capacity\":" << r.capacity << ",\"producers\":" << r.producers
+                      << ",\"consumers\":" << r.consumers << ",\"items\":" << opt.items
+                      << ",\"reps\":" << opt.reps << std::fixed << std::setprecision(4)
+                      << ",\"mops\":{\"median\":" << r.mops.median << ",\"mean\":" << r.mops.mean
+                      << ",\"stddev\":" << r.mops.stddev << "},";
+            latency_json(std::cout, "enqueue_ns", r.enqueue_latency);
+            std::cout << ",";
+            latency_json(std::cout, "dequeue_ns", r.dequeue_latency);
+            std::cout << "}" << std::flush;
+        } else {
+            std::ostringstream shape, enq, deq;
+            shape << r.producers << "x" << r.consumers;
+            latency_fields(enq, r.enqueue_latency, "/");
+            latency_fields(deq, r.dequeue_latency, "/");
+            std::cout << std::left << std::setw(15) << r.queue << std::right
+                      << std::setw(8) << r.payload << std::setw(9) << r.capacity
+                      << std::setw(7) << shape.str() << std::fixed << std::setprecision(2)
+                      << std::setw(11) << r.mops.median << std::setw(9) << r.mops.stddev << "  "
+                      << std::left << std::setw(30) << enq.str() << deq.str()
+                      << std::right << std::endl;
+        }
+        first_ = false;
+    }
+
+    void end() {
+        if (format_ == "json") std::cout << (first_ ? "]\n" : "\n]\n");
+    }
+};
+
+// ==========================================
+// 6. Command Line
+// ==========================================
+
+void print_usage(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --test NAME       throughput, pingpong or burst (default: throughput)\n"
+              << "  --queues LIST     queue kinds to run (default: all, see --list)\n"
+              << "  --producers LIST  producer thread counts (default: 1,4,16)\n"
+              << "  --consumers LIST  consumer thread counts (default: 1,4,16)\n"
+              << "  --payload LIST    payload sizes in bytes: 8, 16, 64, 256, 1024 (default: 8,64)\n"
+              << "  --capacity LIST   queue capacities, powers of two (default: 65536)\n"
+              << "  --items N         items (round trips for pingpong) per run\n"
+              << "                    (default: 1048576 for throughput, 100000 otherwise)\n"
+              << "  --reps N          measured repetitions (default: 5)\n"
+              << "  --warmup N        unmeasured runs before them (default: 1)\n"
+              << "  --sample N        time every N-th operation, 0 disables (default: 64);\n"
+              << "                    latency tests record every item\n"
+              << "  --burst N         items per burst in the burst test (default: 64)\n"
+              << "  --gap-us N        pause between bursts in microseconds (default: 100)\n"
+              << "  --no-pin          do not pin threads to CPUs\n"
+              << "  --format FMT      table, csv or json (default: table)\n"
+              << "  --list            list queue kinds and exit\n"
+              << "LIST is comma separated, e.g. --producers 1,2,4,8\n"
+              << "pingpong always runs one client and one echo thread\n";
+}
+
+template<typename T>
+std::vector<T> parse_list(const std::string& arg) {
+    std::vector<T> values;
+    std::stringstream ss(arg);
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        if (token.empty()) continue;
+        if constexpr (std::is_same_v<T, std::string>) {
+            values.push_back(token);
+        } else {
+            size_t used = 0;
+            unsigned long long v = std::stoull(token, &used);
+            if (used != token.size()) throw std::invalid_argument(token);
+            values.push_back((T)v);
+        }
+    }
+    if (values.empty()) throw std::invalid_argument(arg);
+    return values;
+}
+
+const QueueKind* find_kind(const std::string& name) {
+    for (const auto& k : QUEUE_KINDS) {
+        if (name == k.name) return &k;
+    }
+    return nullptr;
+}
+
+// Fills opt from argv; returns false (after printing why) on bad input
+bool parse_options(int argc, char** argv, Options& opt, bool& list_only) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        try {
+            if (arg == "--test") {
+                std::string name = value();
+                if (name == "throughput") opt.test = Test::Throughput;
+                else if (name == "pingpong") opt.test = Test::PingPong;
+                else if (name == "burst") opt.test = Test::Burst;
+                else throw std::invalid_argument("unknown test " + name);
+            }
+            else if (arg == "--queues") opt.queues = parse_list<std::string>(value());
+            else if (arg == "--producers") opt.producers = parse_list<int>(value());
+            else if (arg == "--consumers") opt.consumers = parse_list<int>(value());
+            else if (arg == "--payload") opt.payloads = parse_list<size_t>(value());
+            else if (arg == "--capacity") opt.capacities = parse_list<size_t>(value());
+            else if (arg == "--items") opt.items = parse_list<uint64_t>(value()).at(0);
+            else if (arg == "--reps") opt.reps = parse_list<int>(value()).at(0);
+            else if (arg == "--warmup") opt.warmup = parse_list<int>(value()).at(0);
+            else if (arg == "--sample") opt.sample_every = parse_list<size_t>(value()).at(0);
+            else if (arg == "--burst") opt.burst = parse_list<size_t>(value()).at(0);
+            else if (arg == "--gap-us") opt.gap_us = parse_list<unsigned>(value()).at(0);
+            else if (arg == "--no-pin") opt.pin = false;
+            else if (arg == "--format") opt.format = value();
+            else if (arg == "--list") list_only = true;
+            else if (arg == "--help" || arg == "-h") { print_usage(argv[0]); std::exit(0); }
+            else throw std::invalid_argument("unknown option " + arg);
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid argument: " << e.what() << "\n";
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (opt.items == 0) {
+        opt.items = opt.test == Test::Throughput ? 1 << 20 : 100000;
+    }
+    if (opt.queues.empty()) {
+        for (const auto& k : QUEUE_KINDS) opt.queues.push_back(k.name);
+    }
+    for (const auto& q : opt.queues) {
+        if (!find_kind(q)) {
+            std::cerr << "Unknown queue kind: " << q << " (see --list)\n";
+            return false;
+        }
+    }
+    for (size_t c : opt.capacities) {
+        if (c < 2 || (c & (c - 1)) != 0) {
+            std::cerr << "Capacity must be a power of two >= 2: " << c << "\n";
+            return false;
+        }
+    }
+    for (size_t p : opt.payloads) {
+        if (p != 8 && p != 16 && p != 64 && p != 256 && p != 1024) {
+            std::cerr << "Unsupported payload size: " << p << "\n";
+            return false;
+        }
+    }
+    auto positive = [](const std::vector<int>& v) {
+        return std::all_of(v.begin(), v.end(), [](int n) { return n > 0; });
+    };
+    if (!positive(opt.producers) || !positive(opt.consumers) || opt.reps < 1 || opt.warmup < 0 || opt.burst == 0) {
+        std::cerr << "Thread counts, --reps and --burst must be positive\n";
+        return false;
+    }
+    if (opt.format != "table" && opt.format != "csv" && opt.format != "json") {
+        std::cerr << "Unknown format: " << opt.format << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Runs every requested queue kind, capacity and thread shape for one payload
+template<typename Item>
+bool sweep(const Options& opt, size_t payload, Reporter& reporter) {
+    // Ping-pong has a fixed shape: one client, one echo thread
+    bool pingpong = opt.test == Test::PingPong;
+    const std::vector<int> one{1};
+    for (const auto& name : opt.queues) {
+        const QueueKind& kind = *find_kind(name);
+        if (kind.bulk && opt.test != Test::Throughput) continue;
+        for (size_t capacity : opt.capacities) {
+            for (int np : pingpong ? one : opt.producers) {
+                for (int nc : pingpong ? one : opt.consumers) {
+                    if ((kind.single_producer && np != 1) || (kind.single_consumer && nc != 1)) continue;
+
+                    for (int w = 0; w < opt.warmup; ++w) run_kind<Item>(name, opt, capacity, np, nc);
+
+                    Row row{name, payload, capacity, np, nc, {}, {}, {}};
+                    std::vector<double> mops;
+                    for (int r = 0; r < opt.reps; ++r) {
+                        RunResult run = run_kind<Item>(name, opt, capacity, np, nc);
+                        if (run.consumed != opt.items) {
+                            std::cerr << name << " " << np << "x" << nc << ": consumed "
+                                      << run.consumed << " of " << opt.items << " items\n";
+                            return false;
+                        }
+                        mops.push_back(opt.items / run.seconds / 1000000.0);
+                        row.enqueue_latency.merge(run.enqueue_latency);
+                        row.dequeue_latency.merge(run.dequeue_latency);
+                    }
+                    row.mops = summarize(mops);
+                    reporter.row(opt, row);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool list_only = false;
+    if (!parse_options(argc, argv, opt, list_only)) return 1;
+    if (list_only) {
+        for (const auto& k : QUEUE_KINDS) {
+            std::cout << std::left << std::setw(15) << k.name << k.description << "\n";
+        }
+        return 0;
+    }
+
+    Reporter reporter(opt.format);
+    reporter.begin(opt);
+    for (size_t payload : opt.payloads) {
+        bool ok = true;
+        switch (payload) {
+            case 8:    ok = sweep<Payload<8>>(opt, payload, reporter); break;
+            case 16:   ok = sweep<Payload<16>>(opt, payload, reporter); break;
+            case 64:   ok = sweep<Payload<64>>(opt, payload, reporter); break;
+            case 256:  ok = sweep<Payload<256>>(opt, payload, reporter); break;
+            case 1024: ok = sweep<Payload<1024>>(opt, payload, reporter); break;
+        }
+        if (!ok) return 1;
+    }
+    reporter.end();
     return 0;
 }
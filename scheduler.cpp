@@ -1,19 +1,24 @@
+#include "concurrency/UnboundedQueue.hpp"
+#include "concurrency/WaitableQueue.hpp"
+
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <queue>
 #include <thread>
 using namespace std;
 using Clock = chrono::steady_clock;
 using Time = Clock::time_point;
 using Duration = Clock::duration;
 struct Job {
-  int id;
+  int id = 0;
   function<void()> task;
-  Time when;
-  Clock::duration after;
-  bool is_recurring;
+  Time when{};
+  Clock::duration after = Duration::zero();
+  bool is_recurring = false;
 
  public:
+  Job() = default;
   Job(int id,
       function<void()> task,
       Time when,
@@ -42,58 +47,53 @@ class JobScheduler : public IJobScheduler {
   void stop()
   {
     is_stopped = true;
-    cv.notify_all();
+    inbox.close();  // wakes the scheduler thread if it is waiting
   }
   int schedule(function<void()> task, Time t) override
   {
     int jobId = counter++;
-    {
-      unique_lock<mutex> lock(mtx);
-      pq.push(Job({jobId, task, t}));
-    }
-    cv.notify_all();  // notify when we add.
+    inbox.enqueue(Job({jobId, task, t}));  // wakes the scheduler thread
     return jobId;
   }
   int recurringSchedule(function<void()> task, Time t, Duration d) override
   {
     int jobId = counter++;
-    {
-      unique_lock<mutex> lock(mtx);
-      pq.push(Job({jobId, task, t, d}));
-    }
-    cv.notify_all();  // notify when we add.
+    inbox.enqueue(Job({jobId, task, t, d}));  // wakes the scheduler thread
     return jobId;
   }
 
  private:
+  // Only this thread touches pq; schedule() hands new jobs over through the
+  // lock-free inbox, so callers never contend with the scheduler for a lock.
   void run()
   {
+    Job job;
     // Have a stop functionality.
     while (!is_stopped) {
-      unique_lock<mutex> lock(mtx);
       if (pq.empty()) {
-        cv.wait(lock, [this]() {
-          return !pq.empty() || is_stopped;
-        });  // wait until pq has element
+        if (!inbox.wait_dequeue(job)) break;  // closed by stop()
+        pq.push(move(job));
+      }
+      while (inbox.dequeue(job)) {
+        pq.push(move(job));
       }
-      if (is_stopped) break;
       auto next_run_time = pq.top().when;
-      cv.wait_until(lock, next_run_time, [this, &next_run_time]() {
-        return is_stopped || pq.top().when < next_run_time;
-      });
-      if (pq.top().when <= Clock::now()) {
-        auto job = pq.top();
-        pq.pop();
-        lock.unlock();
+      auto now = Clock::now();
+      if (next_run_time > now) {
+        // Sleep until the earliest job is due or a new one arrives
+        if (inbox.wait_dequeue_for(job, next_run_time - now)) {
+          pq.push(move(job));
+        }
+        continue;
+      }
+      job = pq.top();
+      pq.pop();
 
-        thread(job.task).detach();
+      thread(job.task).detach();
 
-        if (job.is_recurring) {
-          job.when += job.after;
-          lock.lock();
-          pq.push(job);
-          lock.unlock();
-        }
+      if (job.is_recurring) {
+        job.when += job.after;
+        pq.push(job);
       }
     }
   }
@@ -101,9 +101,8 @@ class JobScheduler : public IJobScheduler {
  private:
   thread scheduler_thread;
   atomic<int> counter{0};
-  mutex mtx;
   priority_queue<Job> pq;
-  condition_variable cv;
+  WaitableQueue<UnboundedMPMCQueue<Job>> inbox;  // Jobs not yet in pq
   atomic<bool> is_stopped{false};
 };
 int main()
@@ -1,38 +1,38 @@
+#include "concurrency/UnboundedQueue.hpp"
+#include "concurrency/WaitableQueue.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <exception>
 #include <functional>
 #include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <numeric>
+#include <optional>
 #include <thread>
 #include <vector>
 
 using namespace std;
 
 // Custom ThreadPool implementation (C++ has no standard thread pool yet)
+//
+// Tasks go through a lock-free unbounded queue: submitting never takes a
+// lock, and idle workers spin briefly and then sleep on an eventcount.
 class ThreadPool {
  public:
   // Constructor: creates worker threads
-  ThreadPool(size_t numThreads) : stop(false)
+  ThreadPool(size_t numThreads)
   {
     for (size_t i = 0; i < numThreads; ++i) {
       workers.emplace_back([this] {
-        while (true) {
-          function<void()> task;
-          {
-            unique_lock<mutex> lock(queueMutex);
-            // Wait until there's a task or stop signal
-            condition.wait(lock, [this] { return stop || !tasks.empty(); });
-
-            if (stop && tasks.empty()) {
-              return;  // Exit thread
-            }
-
-            task = move(tasks.front());
-            tasks.pop();
-          }
-          task();  // Execute task outside the lock
+        function<void()> task;
+        // Returns false once the pool is stopping and no task is left
+        while (tasks.wait_dequeue(task)) {
+          task();
         }
       });
     }
@@ -49,41 +49,262 @@ class ThreadPool {
         bind(forward<F>(f), forward<Args>(args)...));
 
     future<return_type> res = task->get_future();
-    {
-      unique_lock<mutex> lock(queueMutex);
-
-      if (stop) {
-        throw runtime_error("enqueue on stopped ThreadPool");
-      }
-
-      tasks.emplace([task]() { (*task)(); });
+    // The queue rejects pushes once the destructor has closed it, so a task
+    // can never slip in after the workers have drained the queue
+    if (!tasks.emplace([task]() { (*task)(); })) {
+      throw runtime_error("enqueue on stopped ThreadPool");
     }
-    condition.notify_one();
     return res;
   }
 
+  // Number of worker threads
+  size_t size() const { return workers.size(); }
+
   // Destructor: waits for all tasks to complete
   ~ThreadPool()
   {
-    {
-      unique_lock<mutex> lock(queueMutex);
-      stop = true;
-    }
-    condition.notify_all();
+    tasks.close();  // Workers finish the queued tasks, then exit
     for (thread& worker : workers) {
       worker.join();
     }
   }
 
  private:
-  vector<thread> workers;         // Worker threads
-  queue<function<void()>> tasks;  // Task queue
+  vector<thread> workers;  // Worker threads
+  WaitableQueue<UnboundedMPMCQueue<function<void()>>> tasks;  // Task queue
+};
+
+// Parallel STL-style algorithms on top of ThreadPool.
+//
+// Every algorithm takes the pool explicitly. The range is cut into several
+// chunks per thread and workers claim chunks from a shared atomic cursor, so
+// a thread that finishes early keeps taking work instead of idling behind a
+// slow one. The calling thread claims chunks as well and then waits on a
+// completion count (not on futures), so calling these from inside a pool task
+// cannot deadlock even when every worker is busy.
+namespace detail {
 
-  mutex queueMutex;              // Protects task queue
-  condition_variable condition;  // For thread synchronization
-  bool stop;                     // Stop flag
+const size_t kDefaultGrain = 1024;  // Minimum elements per chunk
+const size_t kChunksPerThread = 4;  // Slack for load balancing
+
+// State of one chunked loop. Shared with the helper tasks so that a helper
+// which starts after the call returned only finds an exhausted cursor.
+struct ChunkLoop {
+  size_t numChunks = 0;
+  function<void(size_t)> body;
+  atomic<size_t> next{0};
+  atomic<bool> failed{false};
+
+  mutex m;               // Protects done and error
+  condition_variable cv;
+  size_t done = 0;
+  exception_ptr error;
+
+  void work()
+  {
+    size_t finished = 0;
+    for (size_t c; (c = next.fetch_add(1)) < numChunks; ++finished) {
+      if (failed.load(memory_order_relaxed)) {
+        continue;  // Drain remaining chunks after an exception
+      }
+      try {
+        body(c);
+      }
+      catch (...) {
+        lock_guard<mutex> lock(m);
+        if (!error) error = current_exception();
+        failed = true;
+      }
+    }
+    if (finished > 0) {
+      lock_guard<mutex> lock(m);
+      done += finished;
+      if (done == numChunks) cv.notify_all();
+    }
+  }
 };
 
+// Runs body(0) .. body(numChunks - 1) on the pool and the calling thread.
+// Rethrows the first exception thrown by any chunk.
+inline void runChunks(ThreadPool& pool,
+                      size_t numChunks,
+                      function<void(size_t)> body)
+{
+  if (numChunks == 0) return;
+
+  auto loop = make_shared<ChunkLoop>();
+  loop->numChunks = numChunks;
+  loop->body = move(body);
+
+  size_t helpers = min(pool.size(), numChunks - 1);
+  for (size_t i = 0; i < helpers; ++i) {
+    pool.enqueue([loop] { loop->work(); });
+  }
+  loop->work();
+
+  unique_lock<mutex> lock(loop->m);
+  loop->cv.wait(lock, [&loop] { return loop->done == loop->numChunks; });
+  if (loop->error) rethrow_exception(loop->error);
+}
+
+// Chunk count for n elements: a few chunks per thread, none below grain.
+// Never exceeds n, so every chunk is non-empty.
+inline size_t chunkCount(const ThreadPool& pool, size_t n, size_t grain)
+{
+  size_t byThreads = (pool.size() + 1) * kChunksPerThread;
+  size_t byGrain = (n + max<size_t>(grain, 1) - 1) / max<size_t>(grain, 1);
+  return max<size_t>(1, min(byThreads, byGrain));
+}
+
+// First element index of chunk c
+inline size_t chunkBegin(size_t n, size_t numChunks, size_t c)
+{
+  return n * c / numChunks;
+}
+
+}  // namespace detail
+
+// Applies f to every element of [first, last)
+template <class RandomIt, class UnaryFunction>
+void parallel_for_each(ThreadPool& pool,
+                       RandomIt first,
+                       RandomIt last,
+                       UnaryFunction f,
+                       size_t grain = detail::kDefaultGrain)
+{
+  size_t n = distance(first, last);
+  size_t chunks = detail::chunkCount(pool, n, grain);
+  detail::runChunks(pool, n == 0 ? 0 : chunks, [&](size_t c) {
+    for_each(first + detail::chunkBegin(n, chunks, c),
+             first + detail::chunkBegin(n, chunks, c + 1),
+             f);
+  });
+}
+
+// Writes op(x) for every x in [first, last) to d_first; returns end of output.
+// Chunks write their slice of the output concurrently, so d_first must be a
+// random-access iterator into storage for n elements (not back_inserter).
+template <class RandomIt, class RandomIt2, class UnaryOp>
+RandomIt2 parallel_transform(ThreadPool& pool,
+                             RandomIt first,
+                             RandomIt last,
+                             RandomIt2 d_first,
+                             UnaryOp op,
+                             size_t grain = detail::kDefaultGrain)
+{
+  size_t n = distance(first, last);
+  size_t chunks = detail::chunkCount(pool, n, grain);
+  detail::runChunks(pool, n == 0 ? 0 : chunks, [&](size_t c) {
+    size_t b = detail::chunkBegin(n, chunks, c);
+    size_t e = detail::chunkBegin(n, chunks, c + 1);
+    transform(first + b, first + e, d_first + b, op);
+  });
+  return d_first + n;
+}
+
+// Folds [first, last) into init with op. op must be associative; chunk
+// results are combined left to right, so it need not be commutative.
+template <class RandomIt, class T, class BinaryOp = plus<>>
+T parallel_reduce(ThreadPool& pool,
+                  RandomIt first,
+                  RandomIt last,
+                  T init,
+                  BinaryOp op = {},
+                  size_t grain = detail::kDefaultGrain)
+{
+  size_t n = distance(first, last);
+  if (n == 0) return init;
+
+  size_t chunks = detail::chunkCount(pool, n, grain);
+  vector<optional<T>> partial(chunks);
+  detail::runChunks(pool, chunks, [&](size_t c) {
+    auto it = first + detail::chunkBegin(n, chunks, c);
+    auto end = first + detail::chunkBegin(n, chunks, c + 1);
+    T acc = *it;
+    for (++it; it != end; ++it) acc = op(move(acc), *it);
+    partial[c] = move(acc);
+  });
+
+  for (auto& p : partial) init = op(move(init), move(*p));
+  return init;
+}
+
+// Inclusive scan seeded with init: d_first[i] = init op x[0] op ... op x[i].
+// Two passes: per-chunk totals, then each chunk rescanned from its offset.
+// As with parallel_transform, d_first must be random-access.
+template <class RandomIt, class RandomIt2, class T, class BinaryOp = plus<>>
+RandomIt2 parallel_scan(ThreadPool& pool,
+                        RandomIt first,
+                        RandomIt last,
+                        RandomIt2 d_first,
+                        T init,
+                        BinaryOp op = {},
+                        size_t grain = detail::kDefaultGrain)
+{
+  size_t n = distance(first, last);
+  if (n == 0) return d_first;
+
+  size_t chunks = detail::chunkCount(pool, n, grain);
+  vector<optional<T>> offsets(chunks);
+  offsets[0] = init;
+  if (chunks > 1) {
+    // The last chunk's total is never needed as an offset
+    vector<optional<T>> totals(chunks - 1);
+    detail::runChunks(pool, chunks - 1, [&](size_t c) {
+      auto it = first + detail::chunkBegin(n, chunks, c);
+      auto end = first + detail::chunkBegin(n, chunks, c + 1);
+      T acc = *it;
+      for (++it; it != end; ++it) acc = op(move(acc), *it);
+      totals[c] = move(acc);
+    });
+    for (size_t c = 1; c < chunks; ++c) {
+      offsets[c] = op(*offsets[c - 1], *totals[c - 1]);
+    }
+  }
+
+  detail::runChunks(pool, chunks, [&](size_t c) {
+    size_t b = detail::chunkBegin(n, chunks, c);
+    size_t e = detail::chunkBegin(n, chunks, c + 1);
+    T acc = *offsets[c];
+    for (size_t i = b; i < e; ++i) {
+      acc = op(move(acc), first[i]);
+      d_first[i] = acc;
+    }
+  });
+  return d_first + n;
+}
+
+// Sorts [first, last): chunks are sorted in parallel, then neighbouring runs
+// are merged pairwise, halving the number of runs each round.
+template <class RandomIt, class Compare = less<>>
+void parallel_sort(ThreadPool& pool,
+                   RandomIt first,
+                   RandomIt last,
+                   Compare comp = {},
+                   size_t grain = detail::kDefaultGrain)
+{
+  size_t n = distance(first, last);
+  size_t chunks = detail::chunkCount(pool, n, grain);
+  if (chunks <= 1) {
+    sort(first, last, comp);
+    return;
+  }
+
+  auto at = [&](size_t c) { return first + detail::chunkBegin(n, chunks, c); };
+  detail::runChunks(
+      pool, chunks, [&](size_t c) { sort(at(c), at(c + 1), comp); });
+
+  for (size_t width = 1; width < chunks; width *= 2) {
+    size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+    detail::runChunks(pool, pairs, [&](size_t p) {
+      size_t lo = p * 2 * width;
+      size_t mid = min(lo + width, chunks);
+      size_t hi = min(lo + 2 * width, chunks);
+      if (mid < hi) inplace_merge(at(lo), at(mid), at(hi), comp);
+    });
+  }
+}
+
 // Example usage
 int main()
 {
@@ -135,6 +356,33 @@ int main()
     result.get();
   }
 
+  cout << "\n=== Example 4: Parallel Algorithms ===" << endl;
+  // Example 4: STL-style algorithms that split work across the pool
+  vector<long long> data(1 << 20);
+  iota(data.begin(), data.end(), 1);
+
+  parallel_transform(
+      pool, data.begin(), data.end(), data.begin(), [](long long x) {
+        return x * 2;
+      });
+  long long sum = parallel_reduce(pool, data.begin(), data.end(), 0LL);
+  cout << "Sum of doubled 1.." << data.size() << " = " << sum << endl;
+
+  vector<long long> prefix(data.size());
+  parallel_scan(pool, data.begin(), data.end(), prefix.begin(), 0LL);
+  cout << "Last prefix sum = " << prefix.back() << endl;
+
+  reverse(data.begin(), data.end());
+  parallel_sort(pool, data.begin(), data.end());
+  cout << "Sorted: " << boolalpha << is_sorted(data.begin(), data.end())
+       << endl;
+
+  atomic<long long> evens{0};
+  parallel_for_each(pool, data.begin(), data.end(), [&evens](long long x) {
+    if (x % 4 == 0) evens.fetch_add(1, memory_order_relaxed);
+  });
+  cout << "Multiples of 4: " << evens << endl;
+
   return 0;
 }
 
@@ -172,10 +420,13 @@ KEY CONCEPTS:
 ============
 
 1. Worker Threads: Fixed number of threads waiting for work
-2. Task Queue: Thread-safe queue of tasks to execute
-3. Mutex: Protects the task queue from race conditions
-4. Condition Variable: Efficiently wakes threads when work arrives
+2. Task Queue: Lock-free unbounded MPMC queue; submitting never takes a lock
+3. Eventcount: Idle workers spin briefly, then park until a task arrives
+4. Closing the Queue: Shutdown rejects new tasks and lets workers drain the
+   queued ones before they exit
 5. Future/Promise: Allows returning values from async tasks
+6. Parallel Algorithms: parallel_sort/reduce/transform/scan/for_each split a
+   range into chunks that workers claim from a shared atomic cursor
 
 BENEFITS:
 =========